@@ -0,0 +1,477 @@
+/* Benchmarks of every compiler stage. Writes JSON results to stdout (or 
+   the file given as first argument) and a summary to stderr. A second 
+   argument only runs the benchmarks whose name contains it. */
+
+#include "harness.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "analog-chip.hpp"
+#include "analog-module.hpp"
+#include "shadow-sram.hpp"
+#include "util.hpp"
+#include "source-file.hpp"
+#include "design-cache.hpp"
+#include "document.hpp"
+#include "chip-pool.hpp"
+#include "obc.hpp"
+#include "error.hpp"
+#include <dirent.h>
+#include <fstream>
+#include <sstream>
+#include <random>
+#include <memory>
+#include <atomic>
+#include <new>
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+
+/* Heap allocations made so far, to report how many each chip costs */
+static std::atomic<std::size_t> n_allocations{0};
+
+void *operator new(std::size_t size) {
+    n_allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void *p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void *p) noexcept {
+    std::free(p);
+}
+
+void operator delete(void *p, std::size_t) noexcept {
+    std::free(p);
+}
+
+/* A design with n_consts chained let declarations in front of a chip 
+   that uses all four CABs */
+static std::string synthetic_design(std::size_t n_consts) {
+    std::stringstream ss;
+
+    ss << "let c0 = 0.5;\n";
+    for (std::size_t i = 1; i < n_consts; i++) {
+        ss << "let c" << i << " = c" << i - 1 << " * 0.75 + 1 / 16 - -0.2;"
+           << " # constant " << i << "\n";
+    }
+
+    std::size_t last = n_consts - 1;
+    ss << "chip {\n    io: [ input, input, output, - ],\n    cabs: [\n";
+    for (int cab = 1; cab <= 4; cab++) {
+        ss << "        cab " << cab << " with clocks 1, - {\n"
+           << "            cams: [ SumInv as sum" << cab << " { "
+           << "gain1: c" << last << " / 3, gain2: c" << last / 2 << " / 4 "
+           << "} ]\n        }" << (cab < 4 ? "," : "") << "\n";
+    }
+    ss << "    ],\n    routing: [\n"
+       << "        io1 -> sum1:1, io2 -> sum1:2, sum1 -> sum2:1,\n"
+       << "        sum2 -> sum3:1, sum3 -> sum4:1, sum4 -> io3\n"
+       << "    ]\n}\n";
+
+    return ss.str();
+}
+
+static std::vector<std::string> test_designs(std::string const &dir) {
+    std::vector<std::string> files;
+
+    if (DIR *d = opendir(dir.c_str())) {
+        while (dirent *entry = readdir(d)) {
+            std::string name = entry->d_name;
+            if (name.size() > 4 && name.substr(name.size() - 4) == ".acf") {
+                files.push_back(dir + "/" + name);
+            }
+        }
+        closedir(d);
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+}
+
+static void add_frontend(BenchSuite &suite) {
+    for (std::size_t n_consts : { 100, 10000 }) {
+        auto text = std::make_shared<std::string>(synthetic_design(n_consts));
+        std::string suffix = "/" + std::to_string(text->size()) + "B";
+
+        suite.add("lex" + suffix, [text]() {
+            Lexer lexer;
+            do_not_optimize(lexer.lex_view(*text, "<synthetic>"));
+        });
+        /* Parsing pulls its tokens from the lexer, so it includes lexing */
+        suite.add("parse" + suffix, [text]() {
+            Lexer lexer;
+            lexer.open_view(*text, "<synthetic>");
+            Parser parser;
+            do_not_optimize(parser.parse(lexer));
+        });
+    }
+}
+
+/* Sums all bytes, as the lexer touches every byte of its input once */
+static unsigned checksum(std::string_view text) {
+    unsigned sum = 0;
+    for (char c : text) {
+        sum += static_cast<unsigned char>(c);
+    }
+    return sum;
+}
+
+/* Reading a large design: the original copy through a stringstream 
+   against the read-only mapping the lexer uses */
+static void add_read(BenchSuite &suite, std::string const &filename) {
+    suite.add("read/ifstream/50MB", [filename]() {
+        std::ifstream file(filename);
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string text = buffer.str();
+        do_not_optimize(checksum(text));
+    });
+
+    suite.add("read/mmap/50MB", [filename]() {
+        SourceFile file = SourceFile::Open(filename);
+        do_not_optimize(checksum(file.text()));
+    });
+}
+
+static void add_ratios(BenchSuite &suite) {
+    auto values = std::make_shared<std::vector<std::vector<double>>>();
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> gain(0.0, 4.0);
+    for (std::size_t i = 0; i < 64; i++) {
+        values->push_back({ gain(rng), gain(rng), gain(rng) });
+    }
+
+    for (std::size_t n : { 1, 3 }) {
+        suite.add("approximate_ratios/" + std::to_string(n), [values, n]() {
+            std::vector<uint8_t> nums;
+            uint8_t den;
+            for (auto const &v : *values) {
+                std::vector<double> gains(v.begin(), v.begin() + n);
+                approximate_ratios(gains, nums, den);
+                do_not_optimize(den);
+            }
+        });
+    }
+
+    suite.add("compute_gain_encoding", [values]() {
+        for (auto const &v : *values) {
+            do_not_optimize(compute_gain_encoding(v[0], v[1]));
+        }
+    });
+}
+
+static void add_compile(BenchSuite &suite) {
+    for (std::string file : test_designs("tests")) {
+        Lexer lexer;
+        lexer.open(file);
+        auto chip = std::shared_ptr<AnalogChip>(Parser().parse(lexer));
+
+        suite.add("compile/" + file.substr(file.rfind('/') + 1), [chip]() {
+            do_not_optimize(chip->compile());
+        });
+    }
+}
+
+/* What parse_cam does per CAM: building it by name and setting every 
+   parameter of its table by name */
+static void add_cam_parameters(BenchSuite &suite) {
+    for (std::string name : { "GainInv", "SumInv", "Integrator" }) {
+        suite.add("cam/parameters/" + name, [name]() {
+            std::unique_ptr<AnalogModule> cam(AnalogModule::Build(name));
+            ParameterTable const &table = cam->parameters();
+            for (std::size_t i = 0; i < table.size(); i++) {
+                int id = cam->parameter_id(table[i].name);
+                cam->set_parameter(id, 1.0);
+                do_not_optimize(id);
+            }
+        });
+    }
+}
+
+/* Building and tearing down the chips of the test designs, whose CAMs 
+   come from the arena of their chip. Prints the heap allocations of one 
+   round to stderr. */
+static void add_chip_lifetime(BenchSuite &suite, std::string const &filter) {
+    for (std::string file : test_designs("tests")) {
+        auto text = std::make_shared<SourceFile>(SourceFile::Open(file));
+        std::string name = "chip/lifetime/" + file.substr(file.rfind('/') + 1);
+
+        auto round = [text, file]() {
+            Lexer lexer;
+            lexer.open_view(text->text(), file);
+            auto chips = Parser().parse_chips(lexer);
+            for (auto const &chip : chips) {
+                do_not_optimize(chip->compile());
+            }
+        };
+
+        if (name.find(filter) != std::string::npos) {
+            std::size_t before = n_allocations.load();
+            round();
+            std::fprintf(stderr, "%s: %zu allocations\n", name.c_str(),
+                         n_allocations.load() - before);
+        }
+        suite.add(name, round);
+    }
+}
+
+/* A chip with every CAB input driven by a random op-amp or IO cell, 
+   which the router may or may not find channels for */
+static std::string dense_design(std::mt19937 &rng) {
+    char const *sources[] = { "s1", "s2", "s3", "s4", "io1", "io2" };
+    std::stringstream ss;
+
+    ss << "chip {\n    io: [ input, input, output, output ],\n    cabs: [\n";
+    for (int cab = 1; cab <= 4; cab++) {
+        ss << "        cab " << cab << " with clocks 1, - {\n"
+           << "            cams: [ SumInv as s" << cab << " { inputs: 3 } ]\n"
+           << "        },\n";
+    }
+    ss << "    ],\n    routing: [\n";
+    for (int cab = 1; cab <= 4; cab++) {
+        for (int port = 1; port <= 3; port++) {
+            ss << "        " << sources[rng() % 6] << " -> s" << cab << ":" 
+               << port << ",\n";
+        }
+    }
+    for (int io = 3; io <= 4; io++) {
+        ss << "        " << sources[rng() % 4] << " -> io" << io << ",\n";
+    }
+    ss << "    ],\n}\n";
+
+    return ss.str();
+}
+
+/* Compiling dense designs, separately for those that route and those 
+   that do not, where the router also narrows down the links at fault */
+static void add_route(BenchSuite &suite) {
+    using Chips = std::vector<std::shared_ptr<AnalogChip>>;
+    auto routable = std::make_shared<Chips>();
+    auto unroutable = std::make_shared<Chips>();
+
+    std::mt19937 rng(42);
+    for (int i = 0; i < 64; i++) {
+        std::string design = dense_design(rng);
+        Lexer lexer;
+        lexer.open_view(design, "<bench>");
+        std::shared_ptr<AnalogChip> chip = Parser().parse(lexer);
+
+        try {
+            chip->compile();
+            routable->push_back(chip);
+        } catch (DesignError const &) {
+            unroutable->push_back(chip);
+        }
+    }
+
+    for (auto [name, chips] : { std::pair{ "routable", routable },
+                                std::pair{ "unroutable", unroutable } }) {
+        suite.add(std::string("route/dense/") + name 
+                  + "/" + std::to_string(chips->size()), [chips]() {
+            for (auto const &chip : *chips) {
+                try {
+                    do_not_optimize(chip->compile());
+                } catch (DesignError const &e) {
+                    do_not_optimize(e.what());
+                }
+            }
+        });
+    }
+}
+
+/* A full chip of unplaced CAMs, a GainInv and a single input SumInv 
+   per CAB, with random links among them and the IO cells */
+static std::string unplaced_design(std::mt19937 &rng) {
+    char const *sources[] = { "g1", "g2", "g3", "g4", "s1", "s2", "s3", "s4",
+                              "io1", "io2" };
+    std::stringstream ss;
+
+    ss << "chip {\n    io: [ input, input, output, output ],\n"
+       << "    placement_seed: " << rng() % 1000 << ",\n"
+       << "    cabs: [\n        cab with clocks 1, - {\n            cams: [\n";
+    for (int i = 1; i <= 4; i++) {
+        ss << "                GainInv as g" << i << " {},\n"
+           << "                SumInv as s" << i << " { inputs: 1 },\n";
+    }
+    ss << "            ]\n        },\n    ],\n    routing: [\n";
+    for (int i = 1; i <= 4; i++) {
+        ss << "        " << sources[rng() % 10] << " -> g" << i << ",\n"
+           << "        " << sources[rng() % 10] << " -> s" << i << ":1,\n";
+    }
+    for (int io = 3; io <= 4; io++) {
+        ss << "        " << sources[rng() % 8] << " -> io" << io << ",\n";
+    }
+    ss << "    ],\n}\n";
+
+    return ss.str();
+}
+
+/* Parsing full chips whose CAMs are placed by the Placer */
+static void add_place(BenchSuite &suite) {
+    auto designs = std::make_shared<std::vector<std::string>>();
+
+    std::mt19937 rng(42);
+    for (int i = 0; i < 16; i++) {
+        designs->push_back(unplaced_design(rng));
+    }
+
+    suite.add("place/full/" + std::to_string(designs->size()), [designs]() {
+        for (std::string const &design : *designs) {
+            Lexer lexer;
+            lexer.open_view(design, "<bench>");
+            do_not_optimize(Parser().parse(lexer));
+        }
+    });
+}
+
+/* Building a chip against resetting a used one, and compiling the test 
+   designs on fresh chips against recycled ones */
+static void add_chip_reuse(BenchSuite &suite) {
+    suite.add("chip/construct", []() {
+        auto chip = std::make_unique<AnalogChip>();
+        do_not_optimize(chip.get());
+    });
+
+    auto chip = std::make_shared<AnalogChip>();
+    suite.add("chip/reset", [chip]() {
+        chip->reset();
+        do_not_optimize(chip.get());
+    });
+
+    auto pool = std::make_shared<ChipPool>(1);
+    for (std::string file : test_designs("tests")) {
+        auto text = std::make_shared<SourceFile>(SourceFile::Open(file));
+        std::string name = file.substr(file.rfind('/') + 1);
+
+        suite.add("chip/fresh/" + name, [text]() {
+            do_not_optimize(compile_design(text->text(), {}));
+        });
+        suite.add("chip/reused/" + name, [text, pool]() {
+            do_not_optimize(compile_design(text->text(), {}, *pool));
+        });
+    }
+}
+
+/* Elaborating the test designs from text against loading them from a 
+   design cache */
+static void add_design_cache(BenchSuite &suite) {
+    for (std::string file : test_designs("tests")) {
+        auto text = std::make_shared<SourceFile>(SourceFile::Open(file));
+
+        Lexer lexer;
+        lexer.open_view(text->text(), file);
+        DesignCacheWriter writer;
+        Parser parser;
+        parser.set_cache(&writer);
+        parser.parse_chips(lexer);
+        auto blob = std::make_shared<std::vector<uint8_t>>(writer.finish());
+
+        std::string name = file.substr(file.rfind('/') + 1);
+        suite.add("cache/parse/" + name, [text, file]() {
+            Lexer lexer;
+            lexer.open_view(text->text(), file);
+            do_not_optimize(Parser().parse_chips(lexer));
+        });
+        suite.add("cache/load/" + name, [blob, file]() {
+            std::string_view data(reinterpret_cast<char const *>(blob->data()),
+                                  blob->size());
+            do_not_optimize(load_design_cache(data, file));
+        });
+    }
+}
+
+/* Editing one chip in the middle of a design with many chips, as the 
+   language server does on every keystroke, against elaborating it all */
+static void add_document(BenchSuite &suite) {
+    std::string design = synthetic_design(64);
+    std::string chip = design.substr(design.find("chip {"));
+    for (std::size_t i = 1; i < 700; i++) {
+        design += chip;
+    }
+
+    auto document = std::make_shared<Document>("<bench>");
+    document->set_text(design);
+
+    std::size_t middle = design.find("/ 3", design.size() / 2) + 2;
+    auto toggle = std::make_shared<bool>(false);
+
+    suite.add("document/edit", [document, middle, toggle]() {
+        *toggle = !*toggle;
+        document->edit(middle, middle + 1, *toggle ? "2" : "3");
+        do_not_optimize(document->diagnostics());
+    });
+    suite.add("document/open", [design]() {
+        Document document("<bench>");
+        document.set_text(design);
+        do_not_optimize(document.diagnostics());
+    });
+}
+
+static void add_bytestream(BenchSuite &suite) {
+    auto dense = std::make_shared<ShadowSRam>();
+    auto sparse = std::make_shared<ShadowSRam>();
+
+    for (std::size_t i = 0; i < dense->size(); i++) {
+        dense->set(i / 0x20, i % 0x20, (i * 37) % 255 + 1);
+        if (i % 9 == 0) {
+            sparse->set(i / 0x20, i % 0x20, i % 255 + 1);
+        }
+    }
+
+    for (auto [name, ssram] : { std::pair{ "dense", dense }, 
+                                std::pair{ "sparse", sparse } }) {
+        suite.add(std::string("to_data_bytestream/") + name, [ssram]() {
+            std::vector<uint8_t> data;
+            ssram->to_data_bytestream(data);
+            do_not_optimize(data.data());
+        });
+    }
+}
+
+int main(int argc, char *argv[]) {
+    BenchSuite suite;
+    std::string filter = argc > 2 ? argv[2] : "";
+
+    /* Only written when needed, as it takes a while */
+    char large_design[] = "/tmp/obc-bench-XXXXXX";
+    bool read = std::string("read/").find(filter) != std::string::npos
+             || filter.find("read") != std::string::npos;
+    if (read) {
+        int fd = mkstemp(large_design);
+        close(fd);
+
+        std::ofstream f(large_design);
+        f << synthetic_design(880000);
+        f.close();
+
+        add_read(suite, large_design);
+    }
+
+    add_frontend(suite);
+    add_ratios(suite);
+    add_compile(suite);
+    add_cam_parameters(suite);
+    add_chip_lifetime(suite, filter);
+    add_chip_reuse(suite);
+    add_route(suite);
+    add_place(suite);
+    add_design_cache(suite);
+    add_document(suite);
+    add_bytestream(suite);
+
+    suite.run(filter);
+
+    if (read) {
+        std::remove(large_design);
+    }
+
+    if (argc > 1) {
+        std::ofstream f(argv[1]);
+        suite.write_json(f);
+    } else {
+        suite.write_json(std::cout);
+    }
+
+    return 0;
+}
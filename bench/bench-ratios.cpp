@@ -0,0 +1,110 @@
+/* Micro-benchmark of approximate_ratios against the original 
+   implementation, which re-filled a vector for every denominator. Also 
+   checks that both select the same numerators and denominator. Single 
+   gains take the fraction table lookup, several the vectorised search. */
+
+#include "util.hpp"
+#include <iostream>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <limits>
+#include <algorithm>
+#include <cmath>
+
+static void reference_approximate_ratios(std::vector<double> const &values,
+                                         std::vector<uint8_t> &nums, 
+                                         uint8_t &den) {
+    uint8_t best_den = 0;
+    double best_den_delta = std::numeric_limits<double>::infinity();
+    
+    for (uint8_t d = 255; d > 0; d--) {
+        compute_ratios(values, nums, d);
+
+        double delta = 0;
+        for (std::size_t i = 0; i < values.size(); i++) {
+            delta += std::abs(static_cast<double>(nums[i]) / d - values[i]);
+        }
+
+        if (delta < best_den_delta) {
+            best_den = d;
+            best_den_delta = delta;
+        }
+    }
+
+    compute_ratios(values, nums, best_den);
+    den = best_den;
+}
+
+template <typename F>
+static double time_per_call(std::vector<std::vector<double>> const &inputs,
+                            F approximate) {
+    std::vector<uint8_t> nums;
+    uint8_t den = 0;
+    unsigned checksum = 0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (auto const &values : inputs) {
+        approximate(values, nums, den);
+        checksum += den;
+    }
+    std::chrono::duration<double, std::nano> elapsed = 
+            std::chrono::steady_clock::now() - start;
+
+    /* Keeps the calls from being optimized away */
+    if (checksum == 1) {
+        std::cerr << checksum << std::endl;
+    }
+
+    return elapsed.count() / inputs.size();
+}
+
+int main() {
+    constexpr std::size_t NInputs = 20000;
+
+    std::mt19937 rng(42);
+    std::uniform_real_distribution<double> gain(0.0, 4.0);
+
+    bool ok = true;
+
+    /* Number of gains, and the number of values they are padded to with 
+       zeros (as SumInv and Integrator do) */
+    std::size_t const cases[][2] = { { 1, 1 }, { 1, 3 }, { 2, 3 }, { 3, 3 } };
+
+    for (auto const &[n_values, n_padded] : cases) {
+        std::vector<std::vector<double>> inputs(NInputs);
+        for (auto &values : inputs) {
+            for (std::size_t i = 0; i < n_padded; i++) {
+                values.push_back(i < n_values ? gain(rng) : 0.0);
+            }
+        }
+
+        for (auto const &values : inputs) {
+            std::vector<uint8_t> nums, ref_nums;
+            uint8_t den, ref_den;
+            approximate_ratios(values, nums, den);
+            reference_approximate_ratios(values, ref_nums, ref_den);
+            ok = ok && nums == ref_nums && den == ref_den;
+        }
+
+        double ref_ns = time_per_call(inputs, 
+                [](auto const &values, auto &nums, auto &den) {
+            reference_approximate_ratios(values, nums, den);
+        });
+        double new_ns = time_per_call(inputs, 
+                [](auto const &values, auto &nums, auto &den) {
+            approximate_ratios(values, nums, den);
+        });
+
+        std::cout << "approximate_ratios, " << n_values << " of " 
+                  << n_padded << " value(s): " 
+                  << ref_ns << " ns -> " << new_ns << " ns per call ("
+                  << ref_ns / new_ns << "x)" << std::endl;
+    }
+
+    if (!ok) {
+        std::cout << "MISMATCH with reference implementation" << std::endl;
+        return 1;
+    }
+    return 0;
+}
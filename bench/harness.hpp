@@ -0,0 +1,138 @@
+#ifndef OBC_BENCH_HARNESS_HPP
+#define OBC_BENCH_HARNESS_HPP
+
+/* Minimal benchmark harness: every benchmark is calibrated to run for at 
+   least MinSampleTime per sample, then timed over NSamples samples. The 
+   results are written as JSON with per-iteration mean, variance, 
+   standard deviation, minimum, median and maximum in nanoseconds. */
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/* Keeps the computation of value from being optimized away */
+template <typename T>
+inline void do_not_optimize(T const &value) {
+    asm volatile("" : : "r,m"(value) : "memory");
+}
+
+class BenchSuite {
+public:
+    static constexpr std::size_t NSamples = 15;
+    static constexpr std::chrono::milliseconds MinSampleTime{10};
+
+    void add(std::string name, std::function<void()> run) {
+        m_benchmarks.push_back({ std::move(name), std::move(run), 0, {} });
+    }
+
+    /* Runs all benchmarks, or those whose name contains filter */
+    void run(std::string const &filter = "") {
+        for (Benchmark &bench : m_benchmarks) {
+            if (bench.name.find(filter) == std::string::npos) {
+                continue;
+            }
+
+            bench.iterations = calibrate(bench);
+            for (std::size_t i = 0; i < NSamples; i++) {
+                bench.samples.push_back(time(bench) / bench.iterations);
+            }
+
+            Stats stats = statistics(bench.samples);
+            std::cerr << std::left << std::setw(40) << bench.name 
+                      << std::right << std::setw(14) << std::fixed 
+                      << std::setprecision(1) << stats.mean << " ns +- " 
+                      << std::setw(5) << 100 * stats.stddev / stats.mean 
+                      << " %" << std::defaultfloat << std::endl;
+        }
+    }
+
+    void write_json(std::ostream &os) const {
+        os << "{\n  \"samples\": " << NSamples << ",\n  \"benchmarks\": [";
+
+        bool first = true;
+        for (Benchmark const &bench : m_benchmarks) {
+            if (bench.samples.empty()) {
+                continue;
+            }
+
+            Stats stats = statistics(bench.samples);
+            os << (first ? "\n" : ",\n") << "    { \"name\": \"" 
+               << bench.name << "\", \"iterations\": " << bench.iterations
+               << ", \"mean_ns\": " << stats.mean 
+               << ", \"variance_ns2\": " << stats.variance
+               << ", \"stddev_ns\": " << stats.stddev
+               << ", \"min_ns\": " << stats.min
+               << ", \"median_ns\": " << stats.median
+               << ", \"max_ns\": " << stats.max << " }";
+            first = false;
+        }
+
+        os << "\n  ]\n}" << std::endl;
+    }
+
+private:
+    struct Benchmark {
+        std::string name;
+        std::function<void()> run;
+        std::size_t iterations;
+        std::vector<double> samples;
+    };
+
+    struct Stats {
+        double mean, variance, stddev, min, median, max;
+    };
+
+    /* Returns the time of bench.iterations runs in nanoseconds */
+    static double time(Benchmark const &bench) {
+        auto start = std::chrono::steady_clock::now();
+        for (std::size_t i = 0; i < bench.iterations; i++) {
+            bench.run();
+        }
+        std::chrono::duration<double, std::nano> elapsed = 
+                std::chrono::steady_clock::now() - start;
+        return elapsed.count();
+    }
+
+    static std::size_t calibrate(Benchmark &bench) {
+        double const min_ns = std::chrono::duration<double, std::nano>(
+                MinSampleTime).count();
+
+        /* The first round doubles as warm-up */
+        for (bench.iterations = 1; ; bench.iterations *= 2) {
+            if (time(bench) >= min_ns) {
+                return bench.iterations;
+            }
+        }
+    }
+
+    static Stats statistics(std::vector<double> samples) {
+        Stats stats = {};
+        std::size_t n = samples.size();
+
+        for (double sample : samples) {
+            stats.mean += sample / n;
+        }
+        for (double sample : samples) {
+            stats.variance += (sample - stats.mean) * (sample - stats.mean);
+        }
+        stats.variance /= n > 1 ? n - 1 : 1;
+        stats.stddev = std::sqrt(stats.variance);
+
+        std::sort(samples.begin(), samples.end());
+        stats.min = samples.front();
+        stats.max = samples.back();
+        stats.median = n % 2 ? samples[n / 2] 
+                             : (samples[n / 2 - 1] + samples[n / 2]) / 2;
+
+        return stats;
+    }
+
+    std::vector<Benchmark> m_benchmarks;
+};
+
+#endif
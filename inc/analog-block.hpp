@@ -31,6 +31,7 @@ public:
     void initialize(int id, AnalogChip &chip);
 
     void setup(Clock &clk_a, Clock &clk_b);
+    bool is_set_up() const { return m_set_up; }
 
     template <typename Module>
     Module &add(Module *module) {
@@ -42,19 +43,50 @@ public:
     Module *add_raw(Module *module) {
         m_modules.push_back(std::unique_ptr<Module>(module));
         module->set_cab(*this);
+        invalidate_routing();
         return module;
     }
 
+    std::vector<std::unique_ptr<AnalogModule>> const &modules() const {
+        return m_modules;
+    }
+
+    /* Inputs of the CAMs, connected or not */
+    std::array<InputPort, 8> &local_ins() { return m_local_ins; }
+
     InputPort &claim_in(AnalogModule &module);
     Capacitor &claim_cap(AnalogModule &module);
     OpAmp &claim_opamp(AnalogModule &module);
     Comparator &claim_comp(AnalogModule &module);
 
+    /* Claims op-amp 2 before op-amp 1, swapping the outputs of the CAMs
+       of the CAB (see explore.hpp) */
+    void set_opamps_reversed(bool reversed) { m_opamps_reversed = reversed; }
+
+    /* Components that are not claimed yet */
+    Resources available() const;
+
     void finalize_comparator();
-    void finalize();
+    void finalize_modules();
 
     void compile(ShadowSRam &ssram);
 
+    /* Releases all channels routed by and to this CAB */
+    void unroute();
+
+    /* Destroys the modules and releases everything they claimed, leaving 
+       the CAB as initialize() did */
+    void reset();
+
+    /* A CAB is dirty when its configuration changed since it was last 
+       compiled, e.g. by a parameter update of one of its modules */
+    bool is_dirty() const { return m_dirty; }
+    void mark_dirty();
+    void clear_dirty() { m_dirty = false; }
+    void invalidate_routing();
+
+    void mark_used_clocks();
+
     std::size_t bank_a() const { return 2 * m_id + 1; }
     std::size_t bank_b() const { return bank_a() + 1; }
 
@@ -79,7 +111,10 @@ public:
     Channel &local_input_channel(Channel::Side side);
     Channel &local_output_channel(Channel::Side side);
 
-    void log_resources() const;
+    /* Local channels driven after routing */
+    std::size_t n_used_channels() const;
+
+    void log_resources(std::ostream &os) const;
 
     bool operator ==(AnalogBlock &other) { return m_id == other.m_id; }
     operator bool() const { return m_id > 0; }
@@ -89,6 +124,7 @@ private:
 
     int m_id;
     bool m_set_up;
+    bool m_dirty;
 
     std::array<InputPort, 8> m_local_ins;
     std::size_t m_next_local_in;
@@ -98,6 +134,7 @@ private:
 
     std::array<OpAmp, NOpAmpsPerBlock> m_opamps;
     std::size_t m_next_opamp;
+    bool m_opamps_reversed;
 
     Comparator m_comp;
 
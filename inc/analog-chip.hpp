@@ -6,7 +6,17 @@
 #include "clock.hpp"
 #include "shadow-sram.hpp"
 #include "analog-block.hpp"
+#include "compile-options.hpp"
+#include "routing-state.hpp"
 #include <array>
+#include <functional>
+#include <memory_resource>
+#include <cstddef>
+
+enum class ConfigurationType {
+    Primary,    /* Complete image, loaded into a cleared SRAM */
+    Update,     /* Partial image on top of the current configuration */
+};
 
 class AnalogChip {
 public:
@@ -19,9 +29,30 @@ public:
     AnalogChip(AnalogChip &&) = delete;
     AnalogChip &operator=(AnalogChip &&) = delete;
 
-    ShadowSRam compile();
+    ShadowSRam compile(CompileOptions const &options = {});
+
+    /* Brings a ShadowSRam produced by an earlier compile() of this chip up 
+       to date. Only CABs marked dirty and, if needed, the clocks are 
+       recompiled; routing changes (links, IO modes, modules) cause a 
+       full recompilation. */
+    void recompile(ShadowSRam &ssram, CompileOptions const &options = {});
+
+    /* Returns the chip to the state it was constructed in, destroying the 
+       CAMs and releasing their arena, so that it can be reused for 
+       another design. The channel tables are left in place. */
+    void reset();
+
+    void invalidate_routing() { m_routing_dirty = true; }
+    void invalidate_clocks() { m_clocks_dirty = true; }
 
-    void to_header_bytestream(std::vector<uint8_t> &data) const;
+    void to_header_bytestream(std::vector<uint8_t> &data, 
+                              ConfigurationType type 
+                                    = ConfigurationType::Primary) const;
+
+    /* Device address in the configuration header, which tells the chips 
+       sharing a configuration stream apart */
+    uint8_t address() const         { return m_address; }
+    void set_address(uint8_t address) { m_address = address; }
 
     AnalogBlock &cab(int id)        { return m_cabs.at(id - 1); }
     AnalogBlock &null_cab()         { return m_null_cab; }
@@ -31,6 +62,9 @@ public:
     Clock &clock(int id)            { return m_clocks.at(id - 1); }
     Clock &null_clock()             { return m_null_clock; }
 
+    /* Finds a CAM by the key it was declared with, or returns nullptr */
+    AnalogModule *find_cam(std::string_view key);
+
     Channel &global_input_direct(IOGroup from, AnalogBlock &to, 
                                  Channel::Side side);
     Channel &global_output_direct(IOGroup to, AnalogBlock &from,
@@ -39,11 +73,46 @@ public:
     Channel &intercam_channel(AnalogBlock &from, AnalogBlock &to, 
                               Channel::Side side);
 
+    /* Drivers of all channels of the chip, see Channel::bind */
+    RoutingState const &routing_state() const { return m_routing; }
+
+    /* Channels driven after routing, and clocks used by the last compile, 
+       which tell how much of the chip a design takes */
+    std::size_t n_used_channels() const;
+    std::size_t n_used_clocks() const;
+
+    /* Diagnostic output of the running compile(), or nullptr */
+    std::ostream *log() const { return m_log; }
+
+    /* Memory for the CAMs of the design, released with the chip or by 
+       reset() */
+    std::pmr::memory_resource &arena() { return m_arena; }
+
 private:
+    static constexpr std::size_t ArenaBlockSize = 4096;
+
+    void compile_all(ShadowSRam &ssram);
+    void compile_dirty(ShadowSRam &ssram);
+    void unroute();
+    void bind_channels();
+
     void compile_clocks(ShadowSRam &ssram);
     void compile_lut_io_control(ShadowSRam &ssram);
     void compile_io_routing(ShadowSRam &ssram);
 
+    /* Declared first, as the CAMs in m_cabs live in it. The first block 
+       is part of the chip, so that a chip that is reset and reused does 
+       not go back to the heap for small designs. */
+    std::array<std::byte, ArenaBlockSize> m_arena_buffer;
+    std::pmr::monotonic_buffer_resource m_arena;
+
+    std::ostream *m_log;
+    std::function<void(AnalogChip &)> const *m_routed;
+    uint8_t m_address;
+
+    bool m_routing_dirty;
+    bool m_clocks_dirty;
+
     std::array<AnalogBlock, NBlocksPerChip> m_cabs;
     AnalogBlock m_null_cab;
 
@@ -52,6 +121,8 @@ private:
     std::array<Clock, 6> m_clocks;
     Clock m_null_clock;
 
+    RoutingState m_routing;
+
     // [iogroup_from][cab_to][side]
     std::array<std::array<std::array<Channel, 2>, 4>, 2> m_global_input_direct_channels;
 
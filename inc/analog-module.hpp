@@ -7,29 +7,50 @@
 #include "opamp.hpp"
 #include "comparator.hpp"
 #include "defs.hpp"
+#include "name-table.hpp"
 #include <bitset>
+#include <memory_resource>
 #include <vector>
 #include <fstream>
 #include <cmath>
 
 class AnalogBlock;
 
-class Parameter {
-public:
-    Parameter(double value)
-            : m_value{value} {}
+class AnalogModule;
 
-    double as_double() { return m_value; }
-    int64_t as_int() { return std::llround(m_value); }
-    bool as_bool() { return as_int(); }
+enum class ParameterType {
+    Double,
+    Int,    /* Rounded to the nearest integer */
+    Bool,   /* Nonzero after rounding */
+};
 
-private:
-    double m_value;
+/* A parameter of a CAM type. Structural parameters determine which 
+   components are claimed, so they cannot change once the CAM was placed. */
+struct ParameterSpec {
+    std::string_view name;
+    ParameterType type;
+    bool structural;
+    void (*set)(AnalogModule &cam, double value);
+};
+
+/* The parameters of a CAM type, declared at compile time. The ID of a 
+   parameter is its index in the table. */
+using ParameterTable = NameTable<ParameterSpec>;
+
+inline constexpr ParameterTable NoParameters;
+
+/* Components a CAM claims from its CAB, see Placer */
+struct Resources {
+    std::size_t capacitors;
+    std::size_t opamps;
+    std::size_t comparators;
+    std::size_t inputs;
 };
 
 class AnalogModule {
 public:
-    AnalogModule(std::string const &name);
+    AnalogModule(std::string const &name, 
+                 ParameterTable const &parameters = NoParameters);
 
     /* Delete copy/move semantics as this breaks links with Ports. */
     AnalogModule(AnalogModule const &) = delete;
@@ -40,11 +61,45 @@ public:
 
     virtual ~AnalogModule() = default;
 
-    static AnalogModule *Build(std::string_view const &name);
-
-    virtual bool set_parameter(std::string_view param, Parameter value) = 0;
-
-    virtual void claim_components() = 0;
+    /* Builds a CAM by type name, in arena if given (see operator new), 
+       or returns nullptr for an unknown type */
+    static AnalogModule *Build(std::string_view const &name,
+                               std::pmr::memory_resource *arena = nullptr);
+
+    /* Index of a CAM type by name, or -1 for an unknown type, and the 
+       same as Build by that index, which hashes no name */
+    static int TypeIndex(std::string_view name);
+    static AnalogModule *Build(std::size_t type,
+                               std::pmr::memory_resource *arena = nullptr);
+
+    /* CAMs are allocated from the heap or, with new (arena), from the 
+       arena of their chip. Either way they are released by delete, 
+       which returns the memory to where it came from. */
+    static void *operator new(std::size_t size);
+    static void *operator new(std::size_t size, 
+                              std::pmr::memory_resource &arena);
+    static void operator delete(void *p);
+    static void operator delete(void *p, std::pmr::memory_resource &arena);
+
+    ParameterTable const &parameters() const { return *m_parameters; }
+
+    /* ID of the named parameter, or -1 if there is none */
+    int parameter_id(std::string_view param) const {
+        return parameters().index(param);
+    }
+
+    void set_parameter(int id, double value);
+    bool is_structural(int id) const { return parameters()[id].structural; }
+
+    /* Sets a parameter of a placed module and marks its CAB for 
+       recompilation */
+    void update_parameter(int id, double value);
+
+    /* What claim_components() will claim with the current parameters */
+    virtual Resources resources() const = 0;
+
+    /* Claims the resources() from the CAB */
+    virtual void claim_components();
     virtual void finalize() = 0;
 
     virtual InputPort &in(std::size_t i = 0);
@@ -60,6 +115,11 @@ public:
 
     std::string const &name() const { return m_name; }
 
+    std::string const &key() const { return m_key; }
+    void set_key(std::string_view key) { m_key = key; }
+
+    void reset_capacitor_cursor() { m_curr_cap = 0; }
+
 protected:
     void claim_inputs(std::size_t n);
     void claim_capacitors(std::size_t n);
@@ -69,6 +129,8 @@ protected:
     AnalogBlock *m_cab;
 
     std::string m_name;
+    std::string m_key;
+    ParameterTable const *m_parameters;
 
     std::array<InputPort *, 8> m_ins;
     std::array<Capacitor *, NCapacitorsPerBlock> m_caps;
@@ -84,12 +146,13 @@ public:
     GainInv();
     GainInv(double gain);
 
-    bool set_parameter(std::string_view param, Parameter value) override;
-
-    void claim_components() override;
+    Resources resources() const override;
     void finalize() override;
 
 private:
+    static const ParameterSpec ParameterSpecs[];
+    static const ParameterTable Parameters;
+
     double m_gain;
 };
 
@@ -98,12 +161,13 @@ public:
     SumInv();
     SumInv(double gain1, double gain2, std::size_t n_inputs = 2);
 
-    bool set_parameter(std::string_view param, Parameter value) override;
-
-    void claim_components() override;
+    Resources resources() const override;
     void finalize() override;
 
 private:
+    static const ParameterSpec ParameterSpecs[];
+    static const ParameterTable Parameters;
+
     std::array<double, 3> m_gains;
     std::size_t m_n_inputs;
 };
@@ -113,12 +177,13 @@ public:
     Integrator();
     Integrator(double integ_const, bool m_gnd_reset);
 
-    bool set_parameter(std::string_view param, Parameter value) override;
-
-    void claim_components() override;
+    Resources resources() const override;
     void finalize() override;
 
 private:
+    static const ParameterSpec ParameterSpecs[];
+    static const ParameterTable Parameters;
+
     std::array<double, 3> m_integ_consts;
     std::array<bool, 3> m_invert;
     bool m_gnd_reset;
@@ -129,9 +194,7 @@ class GainSwitch : public AnalogModule {
 public:
     GainSwitch();
 
-    bool set_parameter(std::string_view param, Parameter value) override;
-
-    void claim_components() override;
+    Resources resources() const override;
     void finalize() override;
 };
 
@@ -139,9 +202,7 @@ class SampleAndHold : public AnalogModule {
 public:
     SampleAndHold();
 
-    bool set_parameter(std::string_view param, Parameter value) override;
-
-    void claim_components() override;
+    Resources resources() const override;
     void finalize() override;
 };
 
@@ -0,0 +1,32 @@
+#ifndef OBC_BATCH_HPP
+#define OBC_BATCH_HPP
+
+#include <functional>
+#include <string>
+#include <vector>
+#include <cstddef>
+
+struct BatchJob {
+    std::string infile;
+    std::string outfile;
+};
+
+/* Reads a batch list: one "<infile> <outfile>" pair per line. Empty lines 
+   and lines starting with '#' are ignored. */
+std::vector<BatchJob> read_batch_list(std::string const &filename);
+
+/* Outcome of run_batch: the error message of every job, empty if the job 
+   succeeded, and the wall time taken */
+struct BatchResult {
+    std::vector<std::string> errors;
+    std::size_t n_failed;
+    double seconds;
+};
+
+/* Runs compile for every job on n_threads worker threads, collecting the 
+   error of each failed job rather than reporting it. */
+BatchResult run_batch(std::vector<BatchJob> const &jobs, 
+                      std::size_t n_threads,
+                      std::function<void(BatchJob const &)> const &compile);
+
+#endif
@@ -37,6 +37,7 @@ public:
                                            Clock::Select select = Clock::A);
 
     Capacitor &claim(AnalogModule &module);
+    void release();
     Capacitor &set_value(uint8_t value);
     Capacitor &set_in(SwitchConfiguration switch_cfg);
     Capacitor &set_out(SwitchConfiguration switch_cfg);
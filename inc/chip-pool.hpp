@@ -0,0 +1,35 @@
+#ifndef OBC_CHIP_POOL_HPP
+#define OBC_CHIP_POOL_HPP
+
+#include "analog-chip.hpp"
+#include <memory>
+#include <vector>
+#include <cstddef>
+
+/* Keeps fully wired AnalogChip models ready for use, so that their 
+   construction can happen outside of the latency-critical path, and 
+   recycles the chips of finished compilations. */
+class ChipPool {
+public:
+    ChipPool(std::size_t capacity);
+
+    /* Returns a pre-built chip, or builds one if the pool ran dry. */
+    std::unique_ptr<AnalogChip> acquire();
+
+    /* Resets a chip that is no longer needed and takes it back, which 
+       is much cheaper than building a new one. Beyond capacity, the 
+       chip is destroyed. */
+    void release(std::unique_ptr<AnalogChip> chip);
+
+    /* Builds chips until the pool is at capacity again. */
+    void replenish();
+
+    std::size_t available() const { return m_chips.size(); }
+    std::size_t capacity() const { return m_capacity; }
+
+private:
+    std::size_t m_capacity;
+    std::vector<std::unique_ptr<AnalogChip>> m_chips;
+};
+
+#endif
@@ -12,6 +12,7 @@ public:
     Comparator(AnalogBlock &cab);
 
     Comparator &claim(AnalogModule &module);
+    void release();
     Comparator &set_configuration(std::array<uint8_t, 2> cfg);
 
     void finalize();
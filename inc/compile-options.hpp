@@ -0,0 +1,23 @@
+#ifndef OBC_COMPILE_OPTIONS_HPP
+#define OBC_COMPILE_OPTIONS_HPP
+
+#include <iostream>
+#include <functional>
+#include <string>
+
+class AnalogChip;
+
+struct CompileOptions {
+    /* Name under which the design is reported in error positions */
+    std::string name = "<input>";
+
+    /* Destination of diagnostic output (routing, realized ratios, 
+       resource usage); nullptr disables diagnostics */
+    std::ostream *log = nullptr;
+
+    /* Called once the links are routed, before the CABs are compiled. It 
+       may throw to give up on the chip, see run_explore. */
+    std::function<void(AnalogChip &)> routed;
+};
+
+#endif
@@ -0,0 +1,89 @@
+#ifndef OBC_DESIGN_CACHE_HPP
+#define OBC_DESIGN_CACHE_HPP
+
+#include "analog-chip.hpp"
+#include "analog-module.hpp"
+#include "chip-pool.hpp"
+#include <array>
+#include <bitset>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+#include <cstdint>
+
+/* Binary form of an elaborated design (`obc --emit-design-cache`).
+
+   A 16-byte header (magic "OBCD", format version, payload size and
+   FNV-1a checksum of the payload, all little-endian 32-bit) is followed
+   by the journal of the elaboration steps the parser took: chips, IO
+   modes, CAB clocks, CAMs with their parameters (CAM types and parameters
+   by index, so the version changes with the CAM and parameter tables)
+   and routing links. Loading replays the journal on fresh chips, reading
+   keys straight from the blob, so the blob can be used in place from a
+   mapped file. */
+namespace design_cache {
+    constexpr char Magic[4]     = { 'O', 'B', 'C', 'D' };
+    constexpr uint32_t Version  = 3;
+    constexpr std::size_t HeaderSize = 16;
+
+    /* Input port number of a comparator input */
+    constexpr uint8_t ComparatorPort = 0xFF;
+}
+
+/* Records the elaboration steps of the parser, see Parser::set_cache. */
+class DesignCacheWriter {
+public:
+    DesignCacheWriter();
+
+    void chip(AnalogChip &chip);
+    void address(uint8_t address);
+    void io_mode(int cell, IOMode mode);
+    void cab_setup(int cab, int clk_a, int clk_b);
+
+    void cam(AnalogModule const *cam, int cab,
+             std::string_view name, std::string_view key);
+    void parameter(int id, double value);
+    void claim();
+
+    /* A link from the output port to the next input port */
+    void output(AnalogModule const *cam, std::size_t port);
+    void input(AnalogModule const *cam, std::size_t port);
+
+    /* Returns the header followed by the recorded steps */
+    std::vector<uint8_t> finish() const;
+
+private:
+    void put(uint8_t value);
+    void put_string(std::string_view s);
+    void put_ref(AnalogModule const *cam);
+
+    std::vector<uint8_t> m_payload;
+
+    /* IO cells and CAMs of the current chip by declaration order */
+    std::unordered_map<AnalogModule const *, uint16_t> m_refs;
+};
+
+/* Renumbering of the CABs and IO cells applied while loading a design 
+   cache, by ID in the design, and the CABs (by ID on the chip) whose 
+   op-amps are claimed in reverse order. Used to build alternatives of a 
+   design, see run_explore. */
+struct ChipVariant {
+    std::array<int, NBlocksPerChip + 1> cabs;
+    std::array<int, NType1IOCellsPerChip + 1> io_cells;
+    std::bitset<NBlocksPerChip + 1> reversed_opamps;
+
+    static ChipVariant Identity();
+};
+
+bool is_design_cache(std::string_view data);
+
+/* Rebuilds the chips of a design cache, taking them from pool if given 
+   and renumbered by variant if given. Throws if the blob is not a valid 
+   cache of this format version. */
+std::vector<std::unique_ptr<AnalogChip>> load_design_cache(
+        std::string_view blob, std::string const &name,
+        ChipPool *pool = nullptr, ChipVariant const *variant = nullptr);
+
+#endif
@@ -0,0 +1,101 @@
+#ifndef OBC_DOCUMENT_HPP
+#define OBC_DOCUMENT_HPP
+
+#include "analog-chip.hpp"
+#include "lexer.hpp"
+#include "token.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+struct Diagnostic {
+    enum Severity {
+        Error = 1,
+        Information = 3,
+    };
+
+    Severity severity;
+    std::size_t offset;
+    std::string message;
+};
+
+/* Design text that is edited in place, as in an editor, with its errors
+   and resource usage kept up to date. After an edit, the tokens outside
+   the edited range are reused, and only the top-level declarations (let,
+   chip) whose text changed, or which use a constant whose value changed,
+   are parsed and elaborated again. */
+class Document {
+public:
+    Document(std::string const &name);
+
+    Document(Document const &) = delete;
+    Document &operator=(Document const &) = delete;
+
+    void set_text(std::string text);
+
+    /* Replaces the text between offsets begin and end by text */
+    void edit(std::size_t begin, std::size_t end, std::string_view text);
+
+    std::string const &text() const { return m_text; }
+
+    /* Current text, for converting offsets to lines and columns */
+    SourceText const &source() const { return m_lexer.source(); }
+
+    /* Errors and the resource usage of every elaborated chip */
+    std::vector<Diagnostic> diagnostics() const;
+
+    /* Chips of the design, nullptr for chips that failed to elaborate */
+    std::vector<AnalogChip const *> chips() const;
+
+    /* Number of declarations elaborated by the last edit */
+    std::size_t n_elaborated() const { return m_n_elaborated; }
+
+private:
+    struct Declaration {
+        TokenType kind;
+        std::size_t begin;
+        std::size_t end;
+        bool stale;
+
+        /* Names of the constants the declaration may use */
+        std::vector<std::string> identifiers;
+
+        /* Let declarations */
+        std::string name;
+        bool defined;
+        double value;
+
+        /* Chip declarations */
+        std::size_t index;
+        std::unique_ptr<AnalogChip> chip;
+        std::string resources;
+
+        bool failed;
+        std::size_t error_offset; /* Relative to begin */
+        std::string error;
+    };
+
+    void update(std::size_t begin, std::size_t old_end,
+                std::size_t new_end);
+    void relex(std::size_t begin, std::size_t old_end, std::size_t new_end);
+    std::vector<Declaration> segment() const;
+    void match(std::vector<Declaration> &decls, std::size_t begin,
+               std::size_t old_end, std::size_t new_end);
+    void elaborate();
+
+    std::string m_name;
+    std::string m_text;
+    Lexer m_lexer;
+
+    /* Tokens of m_text, empty if it could not be lexed */
+    std::vector<Token> m_tokens;
+    std::unique_ptr<Diagnostic> m_lex_error;
+
+    std::vector<Declaration> m_decls;
+    std::vector<Declaration> m_removed;
+    std::size_t m_n_elaborated;
+};
+
+#endif
@@ -3,6 +3,7 @@
 
 #include <string>
 #include <stdexcept>
+#include <cstddef>
 
 class DesignError : public std::exception {
 public:
@@ -17,4 +18,20 @@ private:
     std::string m_reason;
 };
 
+/* Error at an offset into a source text. what() is prefixed with the 
+   position, reason() is the bare message. */
+class SourceError : public std::runtime_error {
+public:
+    SourceError(std::string const &what, std::size_t offset,
+                std::string const &reason)
+            : std::runtime_error{what}, m_offset{offset}, m_reason{reason} {}
+
+    std::size_t offset() const { return m_offset; }
+    std::string const &reason() const { return m_reason; }
+
+private:
+    std::size_t m_offset;
+    std::string m_reason;
+};
+
 #endif
@@ -0,0 +1,60 @@
+#ifndef OBC_EXPLORE_HPP
+#define OBC_EXPLORE_HPP
+
+#include "analog-chip.hpp"
+#include "compile-options.hpp"
+#include "design-cache.hpp"
+#include "obc.hpp"
+#include <memory>
+#include <string>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/* What a variant costs, in order of importance */
+struct VariantCost {
+    uint64_t n_channels;
+    uint64_t n_bytes;
+    uint64_t n_clocks;
+};
+
+/* Best variant found by run_explore, compiled, and how the exploration
+   went: the number of variants compiled of those possible, how many
+   failed or were given up, the wall time taken, and the cost of the
+   design itself or its error */
+struct ExploreResult {
+    ChipVariant variant;
+    std::size_t index;
+    VariantCost cost;
+
+    std::unique_ptr<AnalogChip> chip;
+    CompileResult result;
+
+    std::size_t n_variants;
+    std::size_t n_possible;
+    std::size_t n_failed;
+    std::size_t n_pruned;
+    double seconds;
+
+    VariantCost design_cost;
+    std::string design_error;
+};
+
+/* Compiles up to n_variants alternatives of the single chip of the design
+   on n_threads threads and returns the best one. The alternatives move
+   the used CABs and IO cells to other CABs and IO cells and swap the
+   op-amps of CABs (see ChipVariant); the first is the design itself, the
+   others are drawn in a fixed pseudo-random order. A variant is better if
+   it routes with fewer channels, then if its bytestream is shorter, then
+   if it enables fewer clocks, then if it comes first.
+
+   Every worker loads the variants into a chip of its own from a design
+   cache of the source. The best cost so far is shared through an atomic,
+   so that a variant which already takes more channels once routed is
+   given up before its CABs are compiled. Throws the error of the design
+   itself if no variant compiles. */
+ExploreResult run_explore(std::string_view source,
+                          CompileOptions const &options,
+                          std::size_t n_variants, std::size_t n_threads);
+
+#endif
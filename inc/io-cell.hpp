@@ -21,11 +21,12 @@ public:
 
     /* Only allow in-place (re)initialization */
     void initialize(int id, AnalogBlock &cab);
-   
-    bool set_parameter(std::string_view, Parameter) override { return false; }
 
+    Resources resources() const override { return {}; }
     void claim_components() override {}
-    void finalize() override;
+
+    /* The links of IO cells are routed with all others, see Router */
+    void finalize() override {}
 
     IOMode mode() const { return m_mode; }
     void set_mode(IOMode mode);
@@ -40,6 +41,12 @@ public:
     void set_used_channel(CabColumn &group, Channel &channel);
     Channel &used_channel(CabColumn &group);
 
+    /* Forgets the channels used by this IO-Cell */
+    void unroute();
+
+    /* Disables the cell and forgets its links */
+    void reset();
+
 private:
     AnalogChip *m_chip;
 
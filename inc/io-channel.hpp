@@ -1,6 +1,7 @@
 #ifndef OBC_IO_CHANNEL_HPP
 #define OBC_IO_CHANNEL_HPP
 
+#include <cstddef>
 #include <cstdint>
 #include <variant>
 #include <array>
@@ -9,6 +10,7 @@
 
 class AnalogBlock;
 class IOCell;
+class RoutingState;
 
 enum class OutPortSource;
 class OutputPort;
@@ -83,6 +85,12 @@ struct Channel {
         throw std::runtime_error("Could not route design");
     }
 
+    /* Keeps the driver of the Channel at index id of state */
+    void bind(RoutingState &state, std::size_t id);
+
+    /* Output port the Channel is allocated or reserved for, or nullptr */
+    OutputPort *driver() const;
+
     /* Returns true if Channel is driven by output port of link */
     bool allocated_for(PortLink &link);
 
@@ -96,6 +104,10 @@ struct Channel {
        can allocate it */
     Channel &reserve(OutputPort &driver);
 
+    /* Drops the driver and any local rerouting, leaving the Channel as 
+       it was before routing */
+    void release();
+
     void set_local_input_source(Channel &source);
     void set_local_output_dest(Channel &dest);
     Channel *local_input_source();
@@ -112,7 +124,10 @@ struct Channel {
     Type type;
     Side side;
 
-    OutputPort *driver;
+    /* Routing state of the chip, see bind(). Channels of no chip, such
+       as None(), are never driven. */
+    RoutingState *state;
+    uint8_t id;
 
     union {
         struct {
@@ -2,8 +2,8 @@
 #define OBC_IO_PORT_HPP
 
 #include "io-channel.hpp"
+#include <array>
 #include <iostream>
-#include <vector>
 #include <cstddef>
 #include <cinttypes>
 
@@ -32,6 +32,31 @@ enum class OutPortSource {
 char const *to_string(InPortSource source);
 char const *to_string(OutPortSource source);
 
+/* Channels a link is routed through, from its output to its input. Routes
+   take at most three channels (e.g. op-amp output, global and local 
+   input), so they are kept inline rather than on the heap. */
+class ChannelPath {
+public:
+    static constexpr std::size_t MaxChannels = 4;
+
+    ChannelPath()
+            : m_channels{}, m_size{} {}
+
+    void push_back(Channel *channel);
+    void clear() { m_size = 0; }
+
+    bool empty() const { return m_size == 0; }
+    std::size_t size() const { return m_size; }
+    Channel *back() const { return m_channels[m_size - 1]; }
+
+    Channel *const *begin() const { return m_channels.data(); }
+    Channel *const *end() const { return m_channels.data() + m_size; }
+
+private:
+    std::array<Channel *, MaxChannels> m_channels;
+    std::size_t m_size;
+};
+
 struct PortLink {
     PortLink();
     PortLink(InputPort *in, OutputPort *out);
@@ -43,7 +68,10 @@ struct PortLink {
 
     InputPort *in;
     OutputPort *out;
-    std::vector<Channel *> channels;
+    ChannelPath channels;
+
+    /* Next link from the same output port */
+    PortLink *next;
 };
 
 class InputPort {
@@ -66,6 +94,12 @@ public:
     bool connected() const { return m_link != nullptr; }
     PortLink *link() { return m_link; }
 
+    /* Forgets the channels the link was routed through */
+    void unroute();
+
+    /* Forgets the link, see AnalogChip::reset() */
+    void disconnect();
+
     friend std::ostream &operator <<(std::ostream &os, InputPort const &in);
 
 private:
@@ -93,8 +127,14 @@ public:
     IOCell &io_cell() { return *m_io_cell; }
     OutPortSource source() const { return m_source; }
 
-    bool connected() const { return !m_links.empty(); }
-    std::vector<PortLink *> &links() { return m_links; }
+    bool connected() const { return m_links != nullptr; }
+
+    /* First of the links from this port in order of connection, see 
+       PortLink::next */
+    PortLink *links() { return m_links; }
+
+    /* Forgets the links, which the input ports own */
+    void disconnect();
 
     friend std::ostream &operator <<(std::ostream &os, OutputPort const &out);
 
@@ -103,7 +143,8 @@ private:
     IOCell *m_io_cell;
     OutPortSource m_source;
 
-    std::vector<PortLink *> m_links;
+    PortLink *m_links;
+    PortLink *m_last_link;
 
     friend InputPort;
 };
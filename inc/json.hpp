@@ -0,0 +1,65 @@
+#ifndef OBC_JSON_HPP
+#define OBC_JSON_HPP
+
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+#include <cstddef>
+
+/* Just enough JSON for the messages of the language server. Objects keep
+   their members in insertion order. */
+class JsonValue {
+public:
+    enum class Type {
+        Null,
+        Bool,
+        Number,
+        String,
+        Array,
+        Object,
+    };
+
+    JsonValue();
+    JsonValue(bool value);
+    JsonValue(double value);
+    JsonValue(int value);
+    JsonValue(std::size_t value);
+    JsonValue(char const *value);
+    JsonValue(std::string value);
+
+    static JsonValue Array();
+    static JsonValue Object();
+
+    /* Throws std::runtime_error on malformed text */
+    static JsonValue Parse(std::string_view text);
+
+    Type type() const { return m_type; }
+    bool is_null() const { return m_type == Type::Null; }
+
+    /* Default values if of another type */
+    bool as_bool() const;
+    double as_number() const;
+    std::string const &as_string() const;
+
+    /* Member of an object, a null value if missing */
+    JsonValue const &operator[](std::string_view key) const;
+    std::vector<JsonValue> const &elements() const { return m_elements; }
+
+    JsonValue &set(std::string key, JsonValue value);
+    JsonValue &push(JsonValue value);
+
+    std::string dump() const;
+    friend std::ostream &operator <<(std::ostream &os, JsonValue const &value);
+
+private:
+    Type m_type;
+    bool m_bool;
+    double m_number;
+    std::string m_string;
+    std::vector<JsonValue> m_elements;
+    std::vector<std::pair<std::string, JsonValue>> m_members;
+};
+
+#endif
@@ -0,0 +1,50 @@
+#ifndef OBC_LANGUAGE_SERVER_HPP
+#define OBC_LANGUAGE_SERVER_HPP
+
+#include "document.hpp"
+#include "json.hpp"
+#include <iostream>
+#include <memory>
+#include <string>
+#include <unordered_map>
+
+/* Language server for editors (`obc --lsp`), speaking JSON-RPC over
+   stdin and stdout with Content-Length framing.
+
+   Documents are synchronized incrementally. After every change, the
+   errors of the document and the resource usage of every chip are
+   published as diagnostics. Columns are counted in bytes, which agrees
+   with the UTF-16 columns of the protocol for ASCII designs. */
+class LanguageServer {
+public:
+    LanguageServer(std::istream &in, std::ostream &out);
+
+    LanguageServer(LanguageServer const &) = delete;
+    LanguageServer &operator=(LanguageServer const &) = delete;
+
+    /* Serves requests until the exit notification or the end of input.
+       Returns the exit status. */
+    int run();
+
+private:
+    bool read_message(std::string &content);
+    void write_message(JsonValue const &message);
+
+    void handle(JsonValue const &message);
+    void reply(JsonValue const &id, JsonValue result);
+    void reply_error(JsonValue const &id, int code, std::string const &s);
+
+    void open(JsonValue const &params);
+    void change(JsonValue const &params);
+    void close(JsonValue const &params);
+    void publish(std::string const &uri);
+
+    std::istream &m_in;
+    std::ostream &m_out;
+
+    std::unordered_map<std::string, std::unique_ptr<Document>> m_documents;
+    bool m_shutdown;
+    bool m_exit;
+};
+
+#endif
@@ -2,41 +2,67 @@
 #define OBC_LEXER_HPP
 
 #include "token.hpp"
+#include "source-file.hpp"
 #include <vector>
 
 class Lexer {
 public:
     Lexer();
 
+    /* Opens input for lexing token by token with next(). The text must 
+       outlive the lexer for open_view, otherwise it is kept by the lexer. */
+    void open(std::string &filename);
+    void open_string(std::string text, std::string const &name);
+    void open_view(std::string_view text, std::string const &name);
+
+    /* Lexes the next token of the opened input, returning EndOfFile at 
+       (and after) the end of the text */
+    Token next();
+
+    /* Continues lexing at offset, which must be the start of a token */
+    void seek(std::size_t offset);
+
+    /* Lexes a file ("-" for stdin). Tokens refer to the text kept by 
+       the lexer, so it must outlive them. */
     std::vector<Token> lex(std::string &filename);
+    std::vector<Token> lex_string(std::string text, std::string const &name);
+
+    /* Lexes text owned by the caller, which must outlive the tokens */
+    std::vector<Token> lex_view(std::string_view text, 
+                                std::string const &name);
+
+    /* Text of the last opened input, which the tokens refer to */
+    SourceText const &source() const { return m_source; }
 
 private:
-    void read_file(std::string &filename);
+    void set_text(std::string_view text, std::string const &name);
+
+    std::vector<Token> lex_text();
 
     bool at_eof() const;
     uint32_t get() const;
     void set_base();
     void forward();
 
-    void lex_identifier();
-    void lex_number();
-    void lex_operator();
-    void lex_separator();
+    Token lex_identifier();
+    Token lex_number();
+    Token lex_operator();
+    Token lex_separator();
     void skip_comment();
 
     std::string_view lexeme() const;
 
-    void emit(TokenType type);
+    Token emit(TokenType type);
 
-    std::string m_text;
+    SourceFile m_file;
+    SourceText m_source;
+    std::string_view m_text;
 
     std::size_t m_curr;
-    TextPosition m_curr_pos;
-
     std::size_t m_base;
-    TextPosition m_base_pos;
 
-    std::vector<Token> m_tokens;
+    /* Tokens lexed since the last report */
+    std::size_t m_count;
 };
 
 #endif
@@ -0,0 +1,41 @@
+#ifndef OBC_MATCHING_HPP
+#define OBC_MATCHING_HPP
+
+#include <vector>
+#include <cstddef>
+
+/* Maximum matching of a bipartite graph by Hopcroft-Karp: augmenting
+   paths are found in phases, a breadth-first search layering the graph
+   from the free left vertices and a depth-first search taking vertex
+   disjoint shortest paths along the layers. */
+class BipartiteMatching {
+public:
+    static constexpr int Free = -1;
+
+    BipartiteMatching(std::size_t n_left, std::size_t n_right);
+
+    void add_edge(std::size_t left, std::size_t right);
+
+    /* Returns the size of a maximum matching */
+    std::size_t solve();
+
+    int match_of_left(std::size_t left) const { return m_left[left]; }
+
+    /* Marks the vertices reachable over alternating paths from a left
+       vertex left free by solve(). The marked right vertices are all
+       matched to marked left vertices, so there is one left vertex more
+       than there are right vertices adjacent to them (Hall's theorem). */
+    void deficient_set(std::size_t left, std::vector<bool> &lefts,
+                       std::vector<bool> &rights) const;
+
+private:
+    bool layer();
+    bool augment(std::size_t left);
+
+    std::vector<std::vector<std::size_t>> m_edges;
+    std::vector<int> m_left;
+    std::vector<int> m_right;
+    std::vector<int> m_depth;
+};
+
+#endif
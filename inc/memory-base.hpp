@@ -47,14 +47,31 @@ public:
     void set(std::size_t bank_addr, std::size_t byte_addr,
              std::initializer_list<MemoryCell> cells);
 
+    /* Unsets all cells, or all cells of one bank, so they can be 
+       written again */
+    void clear();
+    void clear_bank(std::size_t bank_addr);
+
     void to_data_bytestream(std::vector<uint8_t> &data) const;
 
+    /* Emits only the sections whose bytes differ from previous, which 
+       must have the same layout */
+    void to_delta_bytestream(MemoryBase const &previous, 
+                             std::vector<uint8_t> &data) const;
+
+    /* Writes the sections of a data bytestream into memory, overwriting 
+       earlier contents. Returns the number of bytes consumed. */
+    std::size_t apply_data_bytestream(uint8_t const *data, std::size_t size);
+
     std::size_t size() const { return m_bank_size * m_n_banks; }
 
     friend std::ostream &operator <<(std::ostream &stream, 
                                      MemoryBase const &mem);
 
 protected:
+    template <typename Differs>
+    void emit_sections(Differs differs, std::vector<uint8_t> &data) const;
+
     std::size_t translate(std::size_t bank_addr, std::size_t byte_addr) const;
 
     std::size_t m_bank_size;
@@ -0,0 +1,104 @@
+#ifndef OBC_NAME_TABLE_HPP
+#define OBC_NAME_TABLE_HPP
+
+#include <array>
+#include <string_view>
+#include <cstddef>
+#include <cstdint>
+
+/* Constant table of entries with a name member, looked up by name through
+   a perfect hash: the seed of the hash is searched for at compile time
+   until every name lands in a slot of its own, so a lookup hashes the
+   name once and compares it with a single entry. As with gperf, only the
+   length and the first, middle and last characters are hashed; names
+   that agree in all of them fail to compile. */
+template <typename Entry>
+class NameTable {
+public:
+    static constexpr std::size_t NSlots = 32;
+    static constexpr uint8_t Empty = 0xFF;
+    static constexpr uint32_t MaxSeed = 1 << 16;
+
+    constexpr NameTable()
+            : m_entries{}, m_size{}, m_seed{}, m_slots{} {}
+
+    template <std::size_t N>
+    constexpr NameTable(Entry const (&entries)[N])
+            : m_entries{entries}, m_size{N}, m_seed{}, m_slots{} {
+        static_assert(N <= NSlots / 2, "too many entries for a NameTable");
+
+        while (!try_seed()) {
+            if (++m_seed == MaxSeed) {
+                throw "no perfect hash for the names of a NameTable";
+            }
+        }
+    }
+
+    std::size_t size() const { return m_size; }
+    Entry const &operator[](std::size_t i) const { return m_entries[i]; }
+
+    /* Index of the entry with the given name, or -1 */
+    constexpr int index(std::string_view name) const {
+        if (m_size == 0) {
+            return -1;
+        }
+        uint8_t i = m_slots[slot(name, m_seed)];
+        return i != Empty && equal(m_entries[i].name, name) ? i : -1;
+    }
+
+    constexpr Entry const *find(std::string_view name) const {
+        int i = index(name);
+        return i >= 0 ? &m_entries[i] : nullptr;
+    }
+
+private:
+    /* Multiplicative hash of the selected characters */
+    static constexpr std::size_t slot(std::string_view name, uint32_t seed) {
+        std::size_t n = name.size();
+        if (n == 0) {
+            return 0;
+        }
+
+        auto c = [&](std::size_t i) -> uint32_t { 
+            return static_cast<uint8_t>(name[i]); 
+        };
+        uint32_t key = (n & 0xFF) | c(0) << 8 | c(n / 2) << 16 
+                     | c(n - 1) << 24;
+        return ((key ^ seed) * 0x9E3779B1u) >> (32 - 5);
+    }
+
+    /* Names are short, so comparing them inline beats calling memcmp */
+    static constexpr bool equal(std::string_view a, std::string_view b) {
+        if (a.size() != b.size()) {
+            return false;
+        }
+        for (std::size_t i = 0; i < a.size(); i++) {
+            if (a[i] != b[i]) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    constexpr bool try_seed() {
+        for (uint8_t &i : m_slots) {
+            i = Empty;
+        }
+
+        for (std::size_t i = 0; i < m_size; i++) {
+            uint8_t &s = m_slots[slot(m_entries[i].name, m_seed)];
+            if (s != Empty) {
+                return false;
+            }
+            s = static_cast<uint8_t>(i);
+        }
+        return true;
+    }
+
+    Entry const *m_entries;
+    std::size_t m_size;
+    uint32_t m_seed;
+    std::array<uint8_t, NSlots> m_slots;
+};
+
+#endif
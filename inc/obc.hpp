@@ -0,0 +1,59 @@
+#ifndef OBC_OBC_HPP
+#define OBC_OBC_HPP
+
+#include "analog-chip.hpp"
+#include "chip-pool.hpp"
+#include "compile-options.hpp"
+#include "shadow-sram.hpp"
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <cstddef>
+#include <cstdint>
+
+/* Embeddable compiler interface (libobc). These functions do not access 
+   the file system or any process-wide state, so separate threads can 
+   compile concurrently. Errors are reported by throwing, as in the rest 
+   of the compiler. */
+
+struct CompileResult {
+    ShadowSRam ssram;
+
+    /* Configuration header followed by the data sections */
+    std::vector<uint8_t> bytestream;
+};
+
+/* Compiles the first chip of the design source, which is design text or 
+   a design cache. The source is only referenced for the duration of the 
+   call. */
+CompileResult compile_design(std::string_view source,
+                             CompileOptions const &options = {});
+
+/* As above, taking the chip model from a pool of pre-built chips. A pool 
+   must not be shared between threads. */
+CompileResult compile_design(std::string_view source,
+                             CompileOptions const &options, 
+                             ChipPool &pool);
+
+/* Compiles an already elaborated chip. */
+CompileResult compile_chip(AnalogChip &chip, 
+                           CompileOptions const &options = {});
+
+/* Compiles chips, e.g. all chips of a design, concurrently on up to 
+   n_threads threads. Results are in the order of chips. */
+std::vector<CompileResult> compile_chips(
+        std::vector<std::unique_ptr<AnalogChip>> const &chips,
+        CompileOptions const &options, std::size_t n_threads);
+
+/* Returns the header and data sections that turn the configuration 
+   previous into current, both compiled for chip. */
+std::vector<uint8_t> delta_bytestream(AnalogChip const &chip,
+                                      ShadowSRam const &previous,
+                                      ShadowSRam const &current);
+
+/* Updates the result of an earlier compile_chip() of the same chip after 
+   edits, recompiling only what changed (see AnalogChip::recompile). */
+void recompile_chip(AnalogChip &chip, CompileResult &result,
+                    CompileOptions const &options = {});
+
+#endif
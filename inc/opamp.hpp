@@ -14,6 +14,7 @@ public:
     OpAmp(AnalogBlock &cab, int id);
 
     OpAmp &claim(AnalogModule &module);
+    void release();
     OpAmp &set_feedback(SwitchConfiguration switch_cfg);
 
     void compile(AnalogBlock const &cab, ShadowSRam &ssram) const;
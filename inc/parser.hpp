@@ -2,7 +2,11 @@
 #define OBC_PARSER_CPP
 
 #include "token.hpp"
+#include "lexer.hpp"
 #include "analog-chip.hpp"
+#include "chip-pool.hpp"
+#include "design-cache.hpp"
+#include <memory>
 #include <vector>
 #include <unordered_map>
 #include <unordered_set>
@@ -10,25 +14,113 @@
 class Parser {
 public:
     Parser();
+    Parser(ChipPool &pool);
 
-    std::unique_ptr<AnalogChip> parse(std::vector<Token> tokens);
+    /* Parses the input opened by lexer, pulling tokens as needed. The 
+       lexer must outlive the parser, which re-lexes expressions from it 
+       in rebind. Returns the first chip of the design. */
+    std::unique_ptr<AnalogChip> parse(Lexer &lexer);
+
+    /* As above, returning every chip of the design in source order */
+    std::vector<std::unique_ptr<AnalogChip>> parse_chips(Lexer &lexer);
+
+    /* Parses the single declaration at offset of the lexer's input, for 
+       the incremental front end (see Document). A let constant is defined 
+       for the following declarations, a chip is returned, elaborated as 
+       the index-th chip of the design. */
+    std::unique_ptr<AnalogChip> parse_declaration(Lexer &lexer, 
+                                                  std::size_t offset,
+                                                  std::size_t index);
+
+    /* Defines a let constant without parsing its declaration. The name 
+       must outlive the parser. */
+    void define(std::string_view name, double value);
+
+    /* Value of a let constant, or nullptr if it is undefined */
+    double const *find_constant(std::string_view name) const;
+
+    /* Records the elaboration steps of the following parses into cache, 
+       or stops recording if it is nullptr */
+    void set_cache(DesignCacheWriter *cache) { m_cache = cache; }
+
+    /* Throws if constant cannot be swept without rebuilding the chip, 
+       i.e. it is undefined or it (indirectly) determines the structure. */
+    void check_sweepable(std::string_view constant) const;
+
+    /* Redefines a let constant of the parsed design and re-evaluates the 
+       constants and CAM parameters that depend on it. Updated CAMs are 
+       marked for recompilation. */
+    void rebind(std::string_view constant, double value);
 
 private:
+    /* Expression of a let constant (cam is null) or CAM parameter (with
+       parameter ID param), starting at source offset begin */
+    struct Binding {
+        std::string_view name;
+        AnalogModule *cam;
+        int param;
+        std::size_t begin;
+        std::vector<std::string_view> deps;
+    };
+
+    /* Where the CAMs of a cab entry go: on cab, or on any CAB with the 
+       clocks if cab is null (see Placer) */
+    struct CamSite {
+        AnalogBlock *cab;
+        Clock *clk_a;
+        Clock *clk_b;
+    };
+
+    /* CAM of a cab entry without ID, kept on the heap until it is placed,
+       with its parameters for the design cache */
+    struct UnplacedCam {
+        std::unique_ptr<AnalogModule> cam;
+        std::string_view name;
+        Clock *clk_a;
+        Clock *clk_b;
+        std::vector<std::pair<int, double>> parameters;
+    };
+
+    struct PortRef {
+        AnalogModule *cam;
+        std::size_t port;
+        bool comparator;
+    };
+
+    /* Routing entry, connected once every CAM of the chip is placed */
+    struct PendingLink {
+        PortRef out;
+        PortRef in;
+        Token arrow;
+    };
+
+    void bind(std::string_view name, AnalogModule *cam, int param,
+              std::size_t begin);
+    std::unordered_set<std::string_view> dependents(
+            std::string_view constant) const;
+
+    std::string_view lexeme(Token const &token) const {
+        return m_lexer->source().lexeme(token);
+    }
+    [[noreturn]] void error(Token const &token, std::string const &s) const {
+        m_lexer->source().error(token, s);
+    }
+
     [[noreturn]] void expect_error(std::string const &expected);
-    void check_shadowed_definition(Token &name);
+    void check_shadowed_definition(Token const &name);
 
-    AnalogModule *find_cam(AnalogChip &chip, Token &name);
+    AnalogModule *find_cam(AnalogChip &chip, Token const &name);
 
     bool at_eof() const;
-    Token &accept(TokenType type);
-    Token &expect(TokenType type);
+    Token accept(TokenType type);
+    Token expect(TokenType type);
     bool matches(TokenType type);
     void forward();
 
     void open_attribute_map(std::string const &name);
     bool has_next_attribute();
-    Token &parse_attribute();
-    [[noreturn]] void unknown_attribute(Token &attr);
+    Token parse_attribute();
+    [[noreturn]] void unknown_attribute(Token const &attr);
     void close_attribute_map();
 
     bool open_list();
@@ -36,21 +128,23 @@ private:
 
     void parse_let_declaration();
 
-    std::unique_ptr<AnalogChip> parse_chip();
+    std::unique_ptr<AnalogChip> parse_chip(std::size_t index);
     void parse_io_modes(AnalogChip &chip);
     
     void parse_cabs_list(AnalogChip &chip);
-    void parse_cab_setup(AnalogChip &chip, AnalogBlock &cab);
+    CamSite parse_cab_site(AnalogChip &chip);
     Clock &parse_clock_id(AnalogChip &chip);
-    void parse_cab(AnalogBlock &cab);
+    void parse_cab(AnalogChip &chip, CamSite const &site);
 
-    void parse_cam_list(AnalogBlock &cab);
-    void parse_cam(AnalogBlock &cab);
+    void parse_cam_list(AnalogChip &chip, CamSite const &site);
+    void parse_cam(AnalogChip &chip, CamSite const &site);
+    void place_cams(AnalogChip &chip, uint32_t seed);
 
     void parse_routing(AnalogChip &chip);
     void parse_routing_entry(AnalogChip &chip);
-    OutputPort &parse_output_port(AnalogChip &chip);
-    InputPort &parse_input_port(AnalogChip &chip);
+    PortRef parse_output_port(AnalogChip &chip);
+    PortRef parse_input_port(AnalogChip &chip);
+    void connect(PendingLink const &link);
 
     double parse_expression();
     double parse_sum();
@@ -63,14 +157,25 @@ private:
     int64_t parse_integer_expression();
     double parse_double_expression();
 
-    std::vector<Token> m_tokens;
-    std::size_t m_curr;
+    ChipPool *m_pool;
+    DesignCacheWriter *m_cache;
+
+    /* The grammar needs a single token of lookahead */
+    Lexer *m_lexer;
+    Token m_token;
 
     std::vector<std::unordered_set<std::string_view>> m_opened;
     std::vector<std::string> m_opened_names;
 
     std::unordered_map<std::string_view, AnalogModule *> m_chip_cams;
+    std::vector<UnplacedCam> m_unplaced;
+    std::vector<PendingLink> m_links;
     std::unordered_map<std::string_view, double> m_named_consts;
+
+    /* Constants referenced by the current expression */
+    std::vector<std::string_view> m_deps;
+    std::vector<Binding> m_bindings;
+    std::unordered_set<std::string_view> m_structural_consts;
 };
 
 #endif
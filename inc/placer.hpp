@@ -0,0 +1,97 @@
+#ifndef OBC_PLACER_HPP
+#define OBC_PLACER_HPP
+
+#include "analog-module.hpp"
+#include "defs.hpp"
+#include <array>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class AnalogChip;
+class Clock;
+
+/* Assigns CAMs declared without a CAB to CABs of a chip.
+
+   A CAB takes the CAMs whose components fit into what is left of it and
+   whose clocks match its own, or any clocks if it is not set up yet.
+   Among those placements, simulated annealing looks for one whose links
+   occupy few routing channels: links from and to IO cells should take
+   the direct channels of their CAB, links between CAMs an intercab
+   channel rather than a detour over the bi-indirect channels. The
+   annealing draws from a generator seeded by the caller, so the same
+   design and seed always give the same placement. */
+class Placer {
+public:
+    Placer(AnalogChip &chip, uint32_t seed);
+
+    Placer(Placer const &) = delete;
+    Placer &operator=(Placer const &) = delete;
+
+    /* Adds a CAM to be placed on a CAB with the given clocks */
+    void add_cam(AnalogModule &cam, Clock &clk_a, Clock &clk_b);
+
+    /* Adds a link between two IO cells, placed or added CAMs */
+    void add_link(AnalogModule &from, AnalogModule &to);
+
+    /* Returns the CAB ID of every added CAM, in the order they were
+       added. Throws a DesignError if they do not fit on the chip. */
+    std::vector<int> place();
+
+private:
+    static constexpr std::size_t NCells = NType1IOCellsPerChip;
+    static constexpr std::size_t NCabs = NBlocksPerChip;
+
+    enum class Kind {
+        Cell,   /* IO cell, by ID */
+        Cab,    /* CAM placed on the CAB with ID */
+        Cam,    /* Added CAM, by index */
+    };
+
+    struct Node {
+        Kind kind;
+        int id;
+    };
+
+    struct Cam {
+        AnalogModule *module;
+        Resources resources;
+        Clock *clk_a;
+        Clock *clk_b;
+    };
+
+    struct Link {
+        Node from;
+        Node to;
+        int driver;
+    };
+
+    Node node(AnalogModule &module);
+    int driver(AnalogModule &module);
+    int cab_of(Node const &node) const {
+        return node.kind == Kind::Cam ? m_assign[node.id] : node.id;
+    }
+
+    bool fits(int cab) const;
+    bool search(std::size_t i);
+    int cost();
+
+    AnalogChip &m_chip;
+    uint32_t m_seed;
+
+    std::vector<Cam> m_cams;
+    std::vector<Link> m_links;
+    std::vector<AnalogModule *> m_drivers;
+
+    /* CAB ID of each added CAM, and the order of the initial search */
+    std::vector<int> m_assign;
+    std::vector<std::size_t> m_order;
+
+    /* Channels used by the links of the current placement, see cost() */
+    std::vector<uint32_t> m_keys;
+
+    std::array<std::array<bool, NCabs + 1>, NCells + 1> m_direct;
+    std::array<int, NCabs + 1> m_columns;
+};
+
+#endif
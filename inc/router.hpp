@@ -0,0 +1,155 @@
+#ifndef OBC_ROUTER_HPP
+#define OBC_ROUTER_HPP
+
+#include "io-channel.hpp"
+#include "routing-state.hpp"
+#include "defs.hpp"
+#include <array>
+#include <bitset>
+#include <iosfwd>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+class AnalogChip;
+class AnalogBlock;
+class IOCell;
+class OutputPort;
+struct PortLink;
+
+/* Assigns channels to all links of a chip as one problem, rather than
+   one link after the other.
+
+   Every link gets the routes it can take, e.g. through the primary or
+   the secondary bi-indirect channel, and a depth-first search picks one
+   route per link such that no channel carries two signals. The links
+   are taken in the order, and their routes in the preference, of the
+   former greedy router, so that a design it could route is routed the
+   same way. When a link cannot be routed, the search jumps back to the
+   latest link in its conflict set, the links owning the channels that
+   were in the way, and adds the conflict set to that of the link
+   (conflict-directed backjumping).
+
+   Before the search, a matching of the output ports to the channels they
+   need rules out designs with more output ports than channels for them,
+   which the search would only give up on after trying every route. */
+class Router {
+public:
+    /* Local inputs and comparator of each CAB, and the IO cell outputs */
+    static constexpr std::size_t MaxLinks = NBlocksPerChip * (8 + 1)
+                                          + NType1IOCellsPerChip;
+
+    Router(AnalogChip &chip);
+
+    Router(Router const &) = delete;
+    Router &operator=(Router const &) = delete;
+
+    /* Routes every link of the chip, allocating the channels. Throws a
+       DesignError listing a minimal set of links which cannot be routed
+       together if there is no complete assignment. */
+    void route();
+
+private:
+    using LinkSet = std::bitset<MaxLinks>;
+
+    static constexpr std::size_t MaxRoutes = 4;
+    static constexpr std::size_t NUsedSlots = 2 * NType1IOCellsPerChip;
+
+    /* Rerouting of a local channel from or to a global channel */
+    struct Wire {
+        int local;
+        int global;
+    };
+
+    /* One way to route a link. Channels are given by Channel::id. */
+    struct Route {
+        std::array<int, 3> channels;
+        std::size_t n_channels;
+
+        std::array<Wire, 2> wires;
+        std::size_t n_wires;
+
+        /* Channel an IO cell uses for a CAB column, see set_used_channel */
+        int used_slot;
+        int used;
+
+        /* Channels picked by side, which order the routes of a link */
+        std::array<int, 2> choices;
+        std::array<Channel::Side, 2> sides;
+    };
+
+    struct Request {
+        PortLink *link;
+
+        std::array<Route, MaxRoutes> routes;
+        std::size_t n_routes;
+
+        /* Like Channel::find_available, prefer channels the output port
+           of the link already drives */
+        bool prefer_driven;
+    };
+
+    enum class Change {
+        Driver,
+        Wire,
+        Used,
+    };
+
+    struct TrailEntry {
+        Change change;
+        int index;
+    };
+
+    void add_input_cell(IOCell &cell);
+    void add_output_cell(IOCell &cell);
+    void add_cab(AnalogBlock &cab);
+
+    Request &add_request(PortLink &link, bool prefer_driven);
+    Route &add_route(Request &request);
+    int index(Channel &channel);
+
+    void hop(Route &route, Channel &channel);
+    void choose(Route &route, std::size_t i, Channel &channel,
+                Channel::Side side);
+    void wire(Route &route, Channel &local, Channel &global);
+    void use(Route &route, IOCell &cell, CabColumn column, Channel &channel);
+
+    bool solve(LinkSet const &enabled);
+    void order_routes(std::size_t depth, std::size_t i);
+    bool assign(std::size_t i, Route const &route, LinkSet &conflict);
+    void undo(std::size_t mark);
+
+    void check();
+    void apply();
+    [[noreturn]] void fail();
+    void print_links(std::ostream &os, LinkSet const &links) const;
+
+    AnalogChip &m_chip;
+
+    /* Channels of the routes, by Channel::id */
+    std::array<Channel *, RoutingState::MaxChannels> m_channels;
+    std::vector<Request> m_requests;
+
+    /* Search state: a copy of the routing state of the chip, with the
+       request that set each driver, and the local channel rerouting,
+       each with the request that set it, or -1 */
+    RoutingState m_state;
+    std::array<int, RoutingState::MaxChannels> m_driver_owners;
+    std::array<int, RoutingState::MaxChannels> m_wires;
+    std::array<int, RoutingState::MaxChannels> m_wire_owners;
+    std::array<int, NUsedSlots> m_used;
+    std::array<int, NUsedSlots> m_used_owners;
+    std::vector<TrailEntry> m_trail;
+
+    /* Per depth of the search */
+    std::array<std::size_t, MaxLinks> m_order;
+    std::array<std::array<uint8_t, MaxRoutes>, MaxLinks> m_candidates;
+    std::array<std::size_t, MaxLinks> m_cursors;
+    std::array<std::size_t, MaxLinks> m_marks;
+    std::array<LinkSet, MaxLinks> m_conflicts;
+
+    /* Route chosen per request */
+    std::array<std::size_t, MaxLinks> m_choices;
+};
+
+#endif
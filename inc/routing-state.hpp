@@ -0,0 +1,50 @@
+#ifndef OBC_ROUTING_STATE_HPP
+#define OBC_ROUTING_STATE_HPP
+
+#include <array>
+#include <bitset>
+#include <cstddef>
+#include <cstdint>
+
+class OutputPort;
+
+/* Which output port drives each routing channel of a chip, addressed by
+   Channel::id. Occupied channels are a bitset and their drivers small IDs
+   into a table of the output ports seen since the last clear(), so the
+   whole state is a few hundred bytes without pointers into itself: a
+   snapshot is a plain copy, and a search can roll back by restoring one
+   or by undoing its own changes (see Router). */
+class RoutingState {
+public:
+    /* The 72 global channels and 6 local channels of each CAB, the null
+       CAB included, with room to spare */
+    static constexpr std::size_t MaxChannels = 128;
+    static constexpr std::size_t MaxDrivers = 63;
+
+    RoutingState();
+
+    OutputPort *driver(std::size_t channel) const {
+        return m_ports[m_drivers[channel]];
+    }
+
+    bool occupied(std::size_t channel) const { return m_occupied[channel]; }
+    std::size_t n_occupied() const { return m_occupied.count(); }
+
+    /* Sets the driver of a channel, or frees it with nullptr */
+    void set_driver(std::size_t channel, OutputPort *out);
+
+    /* Frees all channels and forgets the output ports */
+    void clear();
+
+private:
+    uint8_t port_id(OutputPort *out);
+
+    std::bitset<MaxChannels> m_occupied;
+    std::array<uint8_t, MaxChannels> m_drivers;
+
+    /* Output ports by ID, the first being none */
+    std::array<OutputPort *, MaxDrivers + 1> m_ports;
+    std::size_t m_n_ports;
+};
+
+#endif
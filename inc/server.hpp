@@ -0,0 +1,86 @@
+#ifndef OBC_SERVER_HPP
+#define OBC_SERVER_HPP
+
+#include "chip-pool.hpp"
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/* Request protocol of the compile daemon (`obc --serve <socket>`).
+
+   Every request is a command byte, followed by the payload length as a
+   big-endian 32-bit integer and the payload itself:
+
+     'C' <len> <design>   compile the design text in the payload
+     'S' <len> <ignored>  query latency statistics
+
+   Every reply is a status byte (0x00 on success, 0x01 on failure), followed
+   by the payload length as a big-endian 32-bit integer and the payload.
+   A successful compile replies with the header and data bytestream, a
+   failed one with the error message. Statistics are replied as text.
+   A connection can carry any number of requests. */
+namespace protocol {
+    constexpr uint8_t Compile  = 'C';
+    constexpr uint8_t Stats    = 'S';
+
+    constexpr uint8_t Ok       = 0x00;
+    constexpr uint8_t Error    = 0x01;
+
+    constexpr uint32_t MaxPayloadSize = 64 * 1024 * 1024;
+}
+
+class LatencyStats {
+public:
+    LatencyStats();
+
+    void record(std::chrono::nanoseconds latency, bool ok);
+
+    std::size_t requests() const { return m_requests; }
+    std::size_t failed() const { return m_failed; }
+
+    friend std::ostream &operator <<(std::ostream &os,
+                                     LatencyStats const &stats);
+
+private:
+    std::size_t m_requests;
+    std::size_t m_failed;
+
+    std::chrono::nanoseconds m_total;
+    std::chrono::nanoseconds m_min;
+    std::chrono::nanoseconds m_max;
+    std::chrono::nanoseconds m_last;
+};
+
+class Server {
+public:
+    Server(std::string const &socket_path, bool verbose);
+    ~Server();
+
+    Server(Server const &) = delete;
+    Server &operator=(Server const &) = delete;
+
+    Server(Server &&) = delete;
+    Server &operator=(Server &&) = delete;
+
+    /* Serves requests until interrupted by SIGINT or SIGTERM. */
+    void run();
+
+private:
+    void open_socket();
+    void serve_connection(int fd);
+    bool handle_request(int fd);
+
+    bool compile(std::string const &text, std::vector<uint8_t> &reply);
+
+    std::string m_socket_path;
+    bool m_verbose;
+    int m_fd;
+
+    ChipPool m_pool;
+    LatencyStats m_stats;
+};
+
+#endif
@@ -1,15 +1,30 @@
 #ifndef OBC_SETTINGS_HPP
 #define OBC_SETTINGS_HPP
 
+#include "batch.hpp"
 #include <string>
+#include <vector>
+#include <cstddef>
 
 struct Args {
     bool verbose;
     bool raw;
     bool add_size;
     bool add_check;
+    bool combine;
+    bool emit_design_cache;
+    bool time_report;
+    bool lsp;
     std::string infile;
     std::string outfile;
+    std::string socket;
+    std::string delta_from;
+    std::string sweep;
+    std::string time_report_file;
+    std::string batch;
+    std::size_t n_threads;
+    std::size_t explore;
+    std::vector<BatchJob> jobs;
 };
 
 extern Args args; 
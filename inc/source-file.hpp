@@ -0,0 +1,37 @@
+#ifndef OBC_SOURCE_FILE_HPP
+#define OBC_SOURCE_FILE_HPP
+
+#include <string>
+#include <string_view>
+#include <cstddef>
+
+/* Text of a design. Regular files are mapped read-only, so that tokens 
+   can refer to the page cache directly; stdin ("-"), pipes and other 
+   unmappable files are read into a buffer instead. The text stays valid 
+   for the lifetime of the SourceFile. */
+class SourceFile {
+public:
+    SourceFile();
+    ~SourceFile();
+
+    SourceFile(SourceFile const &) = delete;
+    SourceFile &operator=(SourceFile const &) = delete;
+
+    SourceFile(SourceFile &&other);
+    SourceFile &operator=(SourceFile &&other);
+
+    static SourceFile Open(std::string const &filename);
+    static SourceFile FromString(std::string text);
+
+    std::string_view text() const;
+    bool is_mapped() const { return m_map != nullptr; }
+
+private:
+    void release();
+
+    void *m_map;
+    std::size_t m_map_size;
+    std::string m_buffer;
+};
+
+#endif
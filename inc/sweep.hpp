@@ -0,0 +1,46 @@
+#ifndef OBC_SWEEP_HPP
+#define OBC_SWEEP_HPP
+
+#include "analog-chip.hpp"
+#include "compile-options.hpp"
+#include "obc.hpp"
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <cstddef>
+
+/* Values first, first + step, ... up to and including last of a let 
+   constant, as given by "<name>=<first>:<last>:<step>". */
+struct SweepRange {
+    std::string constant;
+    double first;
+    double last;
+    double step;
+
+    std::size_t size() const;
+    double value(std::size_t i) const { return first + i * step; }
+};
+
+SweepRange parse_sweep_range(std::string const &spec);
+
+/* Outcome of run_sweep: the error message of every point, empty if the 
+   point compiled, and the wall time taken */
+struct SweepResult {
+    std::vector<std::string> errors;
+    std::size_t n_failed;
+    double seconds;
+};
+
+/* Compiles the design for every value of range on n_threads threads and 
+   calls emit(i, chip, result) for each point from the worker threads. 
+   The source is elaborated once per thread; each point 
+   only re-evaluates the dependent CAM parameters and recompiles the CABs 
+   these belong to. Errors of single points are collected rather than 
+   thrown. */
+SweepResult run_sweep(std::string_view source, CompileOptions const &options,
+                      SweepRange const &range, std::size_t n_threads,
+                      std::function<void(std::size_t, AnalogChip &, 
+                                         CompileResult const &)> const &emit);
+
+#endif
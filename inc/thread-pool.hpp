@@ -0,0 +1,17 @@
+#ifndef OBC_THREAD_POOL_HPP
+#define OBC_THREAD_POOL_HPP
+
+#include <functional>
+#include <cstddef>
+
+/* Number of worker threads to use when none is requested explicitly. */
+std::size_t default_n_threads();
+
+/* Runs job(i, worker) for every i in [0, n) on up to n_threads threads. 
+   Jobs are handed out in order; worker is the index of the executing 
+   thread, so that per-thread state can be kept in an array. The first 
+   exception thrown by a job is rethrown once all threads have joined. */
+void parallel_for(std::size_t n, std::size_t n_threads,
+                  std::function<void(std::size_t, std::size_t)> const &job);
+
+#endif
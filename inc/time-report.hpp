@@ -0,0 +1,133 @@
+#ifndef OBC_TIME_REPORT_HPP
+#define OBC_TIME_REPORT_HPP
+
+#include <iostream>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstddef>
+
+/* Compile phases whose wall time and number of calls are reported.
+   ClaimComponents runs within Parse or LoadDesignCache, Place within
+   Parse; all others are disjoint. Lexing streamed into the parser counts
+   as Parse, Lex only covers lexing an input at once. */
+enum class Phase {
+    Lex,
+    Parse,
+    LoadDesignCache,
+    ClaimComponents,
+    Place,
+    FinalizeComparator,
+    Route,
+    CompileIORouting,
+    CabFinalizeModules,
+    CabCompile,
+    CompileClocks,
+    ToDataBytestream,
+    WriteOutput,
+    NPhases
+};
+
+enum class Counter {
+    TokensLexed,
+    LinksRouted,
+    ChannelsAllocated,
+    CapacitorsProgrammed,
+    SectionsEmitted,
+    NCounters
+};
+
+char const *to_string(Phase phase);
+char const *to_string(Counter counter);
+
+/* Accumulates phase times and counters. Timing is enabled for a thread 
+   by installing a report with ScopedTimeReport; a report may be shared 
+   by several threads. Without a report, the instrumentation only checks 
+   a thread-local pointer. */
+class TimeReport {
+public:
+    TimeReport();
+
+    TimeReport(TimeReport const &) = delete;
+    TimeReport &operator=(TimeReport const &) = delete;
+
+    void add_time(Phase phase, std::chrono::nanoseconds time);
+    void add_count(Counter counter, uint64_t n);
+
+    void write_json(std::ostream &os) const;
+
+    friend std::ostream &operator <<(std::ostream &os, 
+                                     TimeReport const &report);
+
+    /* Report of the calling thread, or nullptr if timing is disabled */
+    static TimeReport *current() { return t_current; }
+
+private:
+    friend class ScopedTimeReport;
+
+    static thread_local TimeReport *t_current;
+
+    static constexpr std::size_t NPhases = 
+            static_cast<std::size_t>(Phase::NPhases);
+    static constexpr std::size_t NCounters = 
+            static_cast<std::size_t>(Counter::NCounters);
+
+    std::array<std::atomic<uint64_t>, NPhases> m_calls;
+    std::array<std::atomic<uint64_t>, NPhases> m_nanoseconds;
+    std::array<std::atomic<uint64_t>, NCounters> m_counters;
+};
+
+/* Makes report the current one of the calling thread for the lifetime 
+   of this object. report may be nullptr to disable timing. */
+class ScopedTimeReport {
+public:
+    explicit ScopedTimeReport(TimeReport *report)
+            : m_previous{TimeReport::t_current} {
+        TimeReport::t_current = report;
+    }
+
+    ~ScopedTimeReport() {
+        TimeReport::t_current = m_previous;
+    }
+
+    ScopedTimeReport(ScopedTimeReport const &) = delete;
+    ScopedTimeReport &operator=(ScopedTimeReport const &) = delete;
+
+private:
+    TimeReport *m_previous;
+};
+
+/* Adds its lifetime to a phase of the current report */
+class PhaseTimer {
+public:
+    explicit PhaseTimer(Phase phase)
+            : m_report{TimeReport::current()}, m_phase{phase}, m_start{} {
+        if (m_report) {
+            m_start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~PhaseTimer() {
+        if (m_report) {
+            m_report->add_time(m_phase, 
+                               std::chrono::steady_clock::now() - m_start);
+        }
+    }
+
+    PhaseTimer(PhaseTimer const &) = delete;
+    PhaseTimer &operator=(PhaseTimer const &) = delete;
+
+private:
+    TimeReport *m_report;
+    Phase m_phase;
+    std::chrono::steady_clock::time_point m_start;
+};
+
+inline void report_count(Counter counter, uint64_t n = 1) {
+    if (TimeReport *report = TimeReport::current()) {
+        report->add_count(counter, n);
+    }
+}
+
+#endif
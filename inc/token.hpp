@@ -4,8 +4,11 @@
 #include <string>
 #include <string_view>
 #include <iostream>
+#include <vector>
+#include <mutex>
+#include <cstdint>
 
-enum class TokenType {
+enum class TokenType : uint8_t {
     None,
     Identifier,
     Number,
@@ -44,7 +47,42 @@ enum class TokenType {
 
 std::size_t constexpr NTokenTypes = static_cast<std::size_t>(TokenType::Final);
 
-char const *to_string(TokenType type);
+/* Spelling of a token type; keyword, operator and separator tables of 
+   the lexer are derived from it */
+constexpr char const *to_string(TokenType type) {
+    switch (type) {
+        case TokenType::None:           return "(none)";
+        case TokenType::Identifier:     return "(identifier)";
+        case TokenType::Number:         return "(number)";
+        case TokenType::EndOfFile:      return "(end-of-file)";
+        case TokenType::Let:            return "let";
+        case TokenType::Chip:           return "chip";
+        case TokenType::With:           return "with";
+        case TokenType::Clocks:         return "clocks";
+        case TokenType::As:             return "as";
+        case TokenType::Cab:            return "cab";
+        case TokenType::Cmp:            return "cmp";
+        case TokenType::True:           return "true";
+        case TokenType::False:          return "false";
+        case TokenType::Arrow:          return "->";
+        case TokenType::Plus:           return "+";
+        case TokenType::Minus:          return "-";
+        case TokenType::Asterisk:       return "*";
+        case TokenType::Slash:          return "/";
+        case TokenType::Equals:         return "=";
+        case TokenType::LBracket:       return "(";
+        case TokenType::RBracket:       return ")";
+        case TokenType::LBrace:         return "{";
+        case TokenType::RBrace:         return "}";
+        case TokenType::LSqBracket:     return "[";
+        case TokenType::RSqBracket:     return "]";
+        case TokenType::Colon:          return ":";
+        case TokenType::Comma:          return ",";
+        case TokenType::Semicolon:      return ";";
+        default:                        return "";
+    }
+}
+
 std::ostream &operator <<(std::ostream &os, TokenType type);
 
 class TextPosition {
@@ -52,11 +90,13 @@ public:
     TextPosition()
             : m_filename{""}, m_line{}, m_col{} {}
 
-    TextPosition(std::string_view filename)
-            : m_filename{filename}, m_line{1}, m_col{1} {}
+    TextPosition(std::string_view filename, std::size_t line, 
+                 std::size_t col)
+            : m_filename{filename}, m_line{line}, m_col{col} {}
 
-    void next_line() { m_line++; m_col = 1; }
-    void next_col() { m_col++; }
+    /* Both counted from 1 */
+    std::size_t line() const { return m_line; }
+    std::size_t col() const { return m_col; }
 
     friend std::ostream &operator <<(std::ostream &os, 
                                      TextPosition const &token);
@@ -66,34 +106,74 @@ private:
     std::size_t m_line, m_col;
 };
 
+/* A token refers to its lexeme by offset into the SourceText it was 
+   lexed from; its position is only computed for error messages. */
 class Token {
 public:
-    Token()
-            : m_type{TokenType::None}, m_lexeme{""}, m_pos{} {}
+    static constexpr std::size_t MaxOffset = UINT32_MAX;
+    static constexpr std::size_t MaxLength = UINT16_MAX;
 
-    Token(TokenType type, std::string_view lexeme, TextPosition const &pos)
-            : m_type{type}, m_lexeme{lexeme}, m_pos{pos} {}
+    Token()
+            : m_offset{}, m_length{}, m_type{TokenType::None} {}
 
-    [[noreturn]] void error(std::string const &s);
+    Token(TokenType type, uint32_t offset, uint16_t length)
+            : m_offset{offset}, m_length{length}, m_type{type} {}
 
     TokenType type() const { return m_type; }
-    std::string_view const &lexeme() const { return m_lexeme; }
-    TextPosition const &pos() const { return m_pos; }
+    uint32_t offset() const { return m_offset; }
+    uint16_t length() const { return m_length; }
 
-    operator bool() { 
+    operator bool() const { 
         return m_type != TokenType::None;
     }
 
-    friend bool operator ==(Token const &token, std::string_view s) {
-        return token.m_lexeme == s;
+private:
+    uint32_t m_offset;
+    uint16_t m_length;
+    TokenType m_type;
+};
+
+static_assert(sizeof(Token) == 8, "tokens should stay compact");
+
+/* Named text that tokens refer to. Line and column are computed from an 
+   index of line start offsets, which is built by the first lookup. */
+class SourceText {
+public:
+    SourceText();
+    SourceText(std::string_view text, std::string const &name);
+
+    SourceText(SourceText const &) = delete;
+    SourceText &operator=(SourceText const &) = delete;
+
+    void reset(std::string_view text, std::string const &name);
+
+    std::string_view text() const { return m_text; }
+    std::string const &name() const { return m_name; }
+
+    std::string_view lexeme(Token const &token) const {
+        return m_text.substr(token.offset(), token.length());
     }
 
-    friend std::ostream &operator <<(std::ostream &os, Token const &token);
+    TextPosition position(std::size_t offset) const;
+
+    /* Offset of a line and column (both counted from 1), clamped to the 
+       line and the text */
+    std::size_t offset(std::size_t line, std::size_t col) const;
+
+    [[noreturn]] void error(std::size_t offset, std::string const &s) const;
+    [[noreturn]] void error(Token const &token, std::string const &s) const {
+        error(token.offset(), s);
+    }
 
 private:
-    TokenType m_type;
-    std::string_view m_lexeme;
-    TextPosition m_pos;
+    /* Builds the line index if needed; m_lines_mutex must be held */
+    std::vector<uint32_t> const &line_starts() const;
+
+    std::string_view m_text;
+    std::string m_name;
+
+    mutable std::mutex m_lines_mutex;
+    mutable std::vector<uint32_t> m_line_starts;
 };
 
 #endif
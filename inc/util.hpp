@@ -2,15 +2,18 @@
 #define OBC_UTIL_HPP
 
 #include <vector>
+#include <iostream>
 #include <cinttypes>
 
 void compute_ratios(std::vector<double> const &values,
                     std::vector<uint8_t> &nums, uint8_t den);
 
 void approximate_ratios(std::vector<double> const &values, 
-                        std::vector<uint8_t> &nums, uint8_t &den);
+                        std::vector<uint8_t> &nums, uint8_t &den,
+                        std::ostream *log = nullptr);
 
-void approximate_ratio(double value, uint8_t &num, uint8_t &den);
+void approximate_ratio(double value, uint8_t &num, uint8_t &den,
+                       std::ostream *log = nullptr);
 
 struct GainEncodingTriple {
     uint8_t C_1;
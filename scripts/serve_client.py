@@ -0,0 +1,45 @@
+import socket
+import struct
+import sys
+
+
+def request(sock: socket.socket, command: bytes, payload: bytes) -> bytes:
+    sock.sendall(command + struct.pack(">I", len(payload)) + payload)
+
+    header = recv_exact(sock, 5)
+    status, size = header[0], struct.unpack(">I", header[1:])[0]
+    body = recv_exact(sock, size)
+
+    if status != 0:
+        raise RuntimeError(body.decode())
+    return body
+
+
+def recv_exact(sock: socket.socket, n: int) -> bytes:
+    data = b""
+    while len(data) < n:
+        chunk = sock.recv(n - len(data))
+        if not chunk:
+            raise RuntimeError("connection closed by server")
+        data += chunk
+    return data
+
+
+def main():
+    if len(sys.argv) < 3:
+        print(f"usage: {sys.argv[0]} [socket] [design files...]")
+        exit(1)
+
+    with socket.socket(socket.AF_UNIX, socket.SOCK_STREAM) as sock:
+        sock.connect(sys.argv[1])
+
+        for filename in sys.argv[2:]:
+            with open(filename, "rb") as file:
+                data = request(sock, b"C", file.read())
+            print(f"{filename}: " + " ".join(str(byte) for byte in data))
+
+        print(request(sock, b"S", b"").decode())
+
+
+if __name__ == "__main__":
+    main()
@@ -1,17 +1,18 @@
 #include "analog-block.hpp"
 #include "analog-chip.hpp"
-#include "settings.hpp"
 #include "io-cell.hpp"
 #include "error.hpp"
+#include "time-report.hpp"
 #include <vector>
 #include <sstream>
 #include <cassert>
 
 AnalogBlock::AnalogBlock()
-        : m_chip{}, m_id{}, m_set_up{false}, 
+        : m_chip{}, m_id{}, m_set_up{false}, m_dirty{false}, 
           m_local_ins{}, m_next_local_in{},
           m_caps{}, m_next_cap{}, 
-          m_opamps{}, m_next_opamp{}, m_comp{*this},
+          m_opamps{}, m_next_opamp{}, m_opamps_reversed{false},
+          m_comp{*this},
           m_used_clocks{nullptr, nullptr}, 
           m_internal_P{}, m_internal_Q{},
           m_local_opamp_channels{}, 
@@ -55,6 +56,9 @@ void AnalogBlock::setup(Clock &clk_a, Clock &clk_b) {
     m_used_clocks[1] = &clk_b;
 
     m_set_up = true;
+
+    mark_dirty();
+    m_chip->invalidate_clocks();
 }
 
 InputPort &AnalogBlock::claim_in(AnalogModule &) {
@@ -88,7 +92,9 @@ OpAmp &AnalogBlock::claim_opamp(AnalogModule &module) {
         throw DesignError(ss.str());
     }
 
-    OpAmp &opamp = m_opamps[m_next_opamp];
+    std::size_t i = m_opamps_reversed ? m_opamps.size() - 1 - m_next_opamp 
+                                      : m_next_opamp;
+    OpAmp &opamp = m_opamps[i];
     m_next_opamp++;
     return opamp.claim(module);
 }
@@ -97,119 +103,29 @@ Comparator &AnalogBlock::claim_comp(AnalogModule &module) {
     return m_comp.claim(module);
 }
 
-void AnalogBlock::finalize_comparator() {
-    m_comp.finalize();
-}
-
-static void allocate_intercab_channel(AnalogBlock &cab, PortLink &link) {
-    InputPort &in = *link.in;
-    OutputPort &out = *link.out;
-
-    assert(in.source() == InPortSource::Local 
-           || in.source() == InPortSource::Comparator);
-
-    Channel::Side side = Channel::source_to_side(out.source());
-    cab.chip().intercam_channel(out.cab(), in.cab(), side).allocate(link);
-}
-
-static void allocate_local_opamp_channel(AnalogBlock &cab, PortLink &link) {
-    InputPort &in = *link.in;
-    OutputPort &out = *link.out;
-
-    assert(in.source() == InPortSource::Local 
-           || in.source() == InPortSource::Comparator);
-
-    Channel::Side side = Channel::source_to_side(out.source());
-    cab.local_opamp_channel(side).allocate(link);
+Resources AnalogBlock::available() const {
+    return { m_caps.size() - m_next_cap, 
+             m_opamps.size() - m_next_opamp,
+             m_comp.is_used() ? 0u : 1u,
+             m_local_ins.size() - m_next_local_in };
 }
 
-static void allocate_external_loopback_channels(AnalogBlock &cab, PortLink &link) {
-    InputPort &in = *link.in;
-    OutputPort &out = *link.out;
-
-    assert(in.source() == InPortSource::Local 
-           || in.source() == InPortSource::Comparator);
-
-    Channel::Side side = Channel::source_to_side(out.source());
-    CabColumn group = Channel::to_cab_column(cab);
-
-    /* OpAmpX -> OutputX -> GlobalY -> InputZ */
-    Channel *output = &cab.local_output_channel(side).allocate(link);
-
-    Channel *global{nullptr};
-    for (Channel::Side side : { Channel::Primary, Channel::Secondary }) {
-        Channel &channel = cab.chip().global_bi_indirect(group, side);
-        if (channel.available(link)) {
-            global = &channel;
-            break;
-        }
-    }
-
-    if (global) {
-        global->allocate(link);
-    } else {
-        throw DesignError("cannot route");
-    }
-
-    Channel *input{nullptr};
-    for (Channel::Side side : { Channel::Primary, Channel::Secondary }) {
-        Channel &channel = cab.local_input_channel(side);
-        if (channel.available(link)) {
-            input = &channel;
-            break;
-        }
-    }
-
-    if (input) {
-        input->allocate(link);
-    } else {
-        throw DesignError("cannot route");
-    }
-
-    input->set_local_input_source(*global);
-    output->set_local_output_dest(*global);
+void AnalogBlock::finalize_comparator() {
+    m_comp.finalize();
 }
 
-void AnalogBlock::finalize() {
-    for (InputPort &in : m_local_ins) {
-        if (!in.connected()) {
-            continue;
-        }
-
-        PortLink &link = *in.link();
-        OutputPort &out = *link.out;
-
-        switch (out.source()) {
-            case OutPortSource::None:
-                break;
-                
-            case OutPortSource::IOCell:
-                break;
-
-            case OutPortSource::OpAmp1:
-            case OutPortSource::OpAmp2:
-                if (out.cab() == in.cab()) {
-                    if (m_id == 3) {
-                        allocate_external_loopback_channels(*this, link);
-                    } else {
-                        allocate_local_opamp_channel(*this, link);
-                    }
-                } else {
-                    allocate_intercab_channel(*this, link);
-                }
-                break;
-        }
-
-        std::cerr << link << std::endl;
-    }
+void AnalogBlock::finalize_modules() {
+    PhaseTimer timer(Phase::CabFinalizeModules);
 
-    if (args.verbose) {
-        log_resources();
+    std::ostream *log = m_chip->log();
+    if (log) {
+        log_resources(*log);
     }
     for (auto const &module : m_modules) {
-        if (args.verbose) {
-            std::cerr << module->name() << ":" << std::endl;
+        if (log) {
+            *log << module->name() << ":" << std::endl;
         }
+        module->reset_capacitor_cursor();
         module->finalize();
     }
 }
@@ -261,14 +177,15 @@ uint8_t local_output_reroute_selector(AnalogBlock &cab) {
 
 void AnalogBlock::compile(ShadowSRam &ssram) {
     /* Enable Clocks */
-    for (Clock *clock : m_used_clocks) {
-        clock->set_is_used(true);
-    }
+    mark_used_clocks();
 
     /* Compile each Capacitor: values and switches */
+    std::size_t n_used_caps = 0;
     for (Capacitor const &cap : m_caps) {
         cap.compile(*this, ssram);
+        n_used_caps += cap.is_used();
     }
+    report_count(Counter::CapacitorsProgrammed, n_used_caps);
 
     /* Compile each OpAmp: switches */
     for (OpAmp const &opamp : m_opamps) {
@@ -289,8 +206,79 @@ void AnalogBlock::compile(ShadowSRam &ssram) {
                                           m_used_clocks[0]->id_nibble()));
 }
 
+void AnalogBlock::unroute() {
+    for (InputPort &in : m_local_ins) {
+        in.unroute();
+    }
+    m_comp.in().unroute();
+
+    for (Channel::Side side : { Channel::Primary, Channel::Secondary }) {
+        local_opamp_channel(side).release();
+        local_input_channel(side).release();
+        local_output_channel(side).release();
+    }
+}
+
+std::size_t AnalogBlock::n_used_channels() const {
+    std::size_t n = 0;
+    for (auto const *channels : { &m_local_opamp_channels, 
+                                  &m_local_input_channels,
+                                  &m_local_output_channels }) {
+        for (Channel const &channel : *channels) {
+            n += channel.driver() != nullptr;
+        }
+    }
+    return n;
+}
+
+void AnalogBlock::reset() {
+    m_modules.clear();
+
+    m_set_up = false;
+    m_dirty = false;
+
+    for (InputPort &in : m_local_ins) {
+        in.disconnect();
+    }
+    m_next_local_in = 0;
+
+    for (Capacitor &cap : m_caps) {
+        cap.release();
+    }
+    m_next_cap = 0;
+
+    for (OpAmp &opamp : m_opamps) {
+        opamp.release();
+    }
+    m_next_opamp = 0;
+    m_opamps_reversed = false;
+
+    m_comp.release();
+
+    m_used_clocks[0] = &m_chip->null_clock();
+    m_used_clocks[1] = &m_chip->null_clock();
+    m_internal_P = nullptr;
+    m_internal_Q = nullptr;
+}
+
+void AnalogBlock::mark_dirty() {
+    m_dirty = true;
+}
+
+void AnalogBlock::invalidate_routing() {
+    m_chip->invalidate_routing();
+}
+
+void AnalogBlock::mark_used_clocks() {
+    for (Clock *clock : m_used_clocks) {
+        clock->set_is_used(true);
+    }
+}
+
 void AnalogBlock::set_used_clock(int i, Clock &clock) {
     m_used_clocks[i] = &clock;
+    mark_dirty();
+    m_chip->invalidate_clocks();
 }
 
 Channel &AnalogBlock::local_opamp_channel(Channel::Side side) {
@@ -305,9 +293,9 @@ Channel &AnalogBlock::local_output_channel(Channel::Side side) {
     return m_local_output_channels.at(static_cast<int>(side));
 }
 
-void AnalogBlock::log_resources() const {
-    std::cerr << m_next_cap << " / " 
-              << NCapacitorsPerBlock << " Capacitors, " 
-              << m_next_opamp << " / " << NOpAmpsPerBlock << " OpAmps, " 
-              << m_comp.is_used() << " / 1 Comparators" << std::endl;
+void AnalogBlock::log_resources(std::ostream &os) const {
+    os << m_next_cap << " / " 
+       << NCapacitorsPerBlock << " Capacitors, " 
+       << m_next_opamp << " / " << NOpAmpsPerBlock << " OpAmps, " 
+       << m_comp.is_used() << " / 1 Comparators" << std::endl;
 }
@@ -1,13 +1,22 @@
 #include "analog-chip.hpp"
 #include "error.hpp"
 #include "util.hpp"
-#include "settings.hpp"
+#include "time-report.hpp"
+#include "router.hpp"
+#include <algorithm>
 #include <sstream>
 #include <cassert>
 
 AnalogChip::AnalogChip()
-        : m_cabs{}, m_null_cab{}, m_io_cells{}, 
-          m_clocks{}, m_null_clock{}, m_intercam_channels{} {
+        : m_arena_buffer{}, 
+          m_arena{m_arena_buffer.data(), m_arena_buffer.size()}, 
+          m_log{}, m_routed{}, m_address{0x01}, 
+          m_routing_dirty{true}, m_clocks_dirty{true}, 
+          m_cabs{}, m_null_cab{}, m_io_cells{}, 
+          m_clocks{}, m_null_clock{}, m_routing{}, 
+          m_global_input_direct_channels{}, 
+          m_global_output_direct_channels{}, 
+          m_global_bi_indirect_channels{}, m_intercam_channels{} {
     m_null_cab.initialize(0, *this);
     for (std::size_t i = 0; i < NBlocksPerChip; i++) {
         m_cabs[i].initialize(i + 1, *this);
@@ -51,51 +60,214 @@ AnalogChip::AnalogChip()
             }
         }
     }
+
+    bind_channels();
+}
+
+/* Numbers the channels of the chip in the routing state */
+void AnalogChip::bind_channels() {
+    std::size_t id = 0;
+    auto bind = [&](Channel &channel) {
+        channel.bind(m_routing, id++);
+    };
+
+    for (auto &group : m_global_input_direct_channels) {
+        for (auto &cab : group) {
+            std::for_each(cab.begin(), cab.end(), bind);
+        }
+    }
+
+    for (auto &group : m_global_output_direct_channels) {
+        for (auto &cab : group) {
+            std::for_each(cab.begin(), cab.end(), bind);
+        }
+    }
+
+    for (auto &group : m_global_bi_indirect_channels) {
+        std::for_each(group.begin(), group.end(), bind);
+    }
+
+    for (auto &from : m_intercam_channels) {
+        for (auto &to : from) {
+            std::for_each(to.begin(), to.end(), bind);
+        }
+    }
+
+    auto bind_local = [&](AnalogBlock &cab) {
+        for (Channel::Side side : { Channel::Primary, Channel::Secondary }) {
+            bind(cab.local_opamp_channel(side));
+            bind(cab.local_input_channel(side));
+            bind(cab.local_output_channel(side));
+        }
+    };
+    std::for_each(m_cabs.begin(), m_cabs.end(), bind_local);
+    bind_local(m_null_cab);
+}
+
+void AnalogChip::reset() {
+    unroute();
+
+    for (AnalogBlock &cab : m_cabs) {
+        cab.reset();
+    }
+
+    for (IOCell &cell : m_io_cells) {
+        cell.reset();
+    }
+
+    for (Clock &clock : m_clocks) {
+        clock.set_is_used(false);
+    }
+
+    /* Only once the CAMs living in it are destroyed */
+    m_arena.release();
+
+    m_log = nullptr;
+    m_routed = nullptr;
+    m_address = 0x01;
+    m_routing_dirty = true;
+    m_clocks_dirty = true;
 }
 
-ShadowSRam AnalogChip::compile() {
+ShadowSRam AnalogChip::compile(CompileOptions const &options) {
     auto ssram = ShadowSRam();
 
+    invalidate_routing();
+    recompile(ssram, options);
+
+    return ssram;
+}
+
+void AnalogChip::recompile(ShadowSRam &ssram, CompileOptions const &options) {
+    m_log = options.log;
+    m_routed = options.routed ? &options.routed : nullptr;
+
+    try {
+        if (m_routing_dirty) {
+            ssram.clear();
+            compile_all(ssram);
+        } else {
+            compile_dirty(ssram);
+        }
+    } catch (...) {
+        /* The ShadowSRam may be partially written */
+        invalidate_routing();
+        throw;
+    }
+
+    m_routing_dirty = false;
+    m_clocks_dirty = false;
+    for (AnalogBlock &cab : m_cabs) {
+        cab.clear_dirty();
+    }
+}
+
+void AnalogChip::compile_all(ShadowSRam &ssram) {
+    unroute();
+
     for (Clock &clock : m_clocks) {
         clock.set_is_used(false);
     }
 
     for (AnalogBlock &cab : m_cabs) {
+        PhaseTimer timer(Phase::FinalizeComparator);
         cab.finalize_comparator();
     }
 
-    for (IOCell &cell : m_io_cells) {
-        cell.finalize();
+    {
+        PhaseTimer timer(Phase::Route);
+        Router(*this).route();
+    }
+    if (m_routed) {
+        (*m_routed)(*this);
     }
 
     compile_lut_io_control(ssram);
-    compile_io_routing(ssram);
+    {
+        PhaseTimer timer(Phase::CompileIORouting);
+        compile_io_routing(ssram);
+    }
 
     for (AnalogBlock &cab : m_cabs) {
-        if (args.verbose) {
-            std::cerr << "Finalizing CAB-" << cab.id() << "..." << std::endl;
+        if (m_log) {
+            *m_log << "Finalizing CAB-" << cab.id() << "..." << std::endl;
         }
-        cab.finalize();
+        cab.finalize_modules();
     }
 
     for (AnalogBlock &cab : m_cabs) {
+        PhaseTimer timer(Phase::CabCompile);
         cab.compile(ssram);
     }
 
+    PhaseTimer timer(Phase::CompileClocks);
     compile_clocks(ssram);
+}
 
-    return ssram;
+void AnalogChip::compile_dirty(ShadowSRam &ssram) {
+    for (AnalogBlock &cab : m_cabs) {
+        if (!cab.is_dirty()) {
+            continue;
+        }
+
+        if (m_log) {
+            *m_log << "Recompiling CAB-" << cab.id() << "..." << std::endl;
+        }
+        cab.finalize_modules();
+
+        PhaseTimer timer(Phase::CabCompile);
+        ssram.clear_bank(cab.bank_a());
+        ssram.clear_bank(cab.bank_b());
+        cab.compile(ssram);
+    }
+
+    if (m_clocks_dirty) {
+        for (Clock &clock : m_clocks) {
+            clock.set_is_used(false);
+        }
+        for (AnalogBlock &cab : m_cabs) {
+            cab.mark_used_clocks();
+        }
+
+        PhaseTimer timer(Phase::CompileClocks);
+        ssram.clear_bank(0x0);
+        compile_clocks(ssram);
+    }
+}
+
+void AnalogChip::unroute() {
+    m_routing.clear();
+
+    for (AnalogBlock &cab : m_cabs) {
+        cab.unroute();
+    }
+
+    for (IOCell &cell : m_io_cells) {
+        cell.unroute();
+    }
+}
+
+std::size_t AnalogChip::n_used_channels() const {
+    return m_routing.n_occupied();
 }
 
-void AnalogChip::to_header_bytestream(std::vector<uint8_t> &data) const {
+std::size_t AnalogChip::n_used_clocks() const {
+    return std::count_if(m_clocks.begin(), m_clocks.end(), 
+                         [](Clock const &clock) { return clock.is_used(); });
+}
+
+void AnalogChip::to_header_bytestream(std::vector<uint8_t> &data,
+                                      ConfigurationType type) const {
+    uint8_t control = type == ConfigurationType::Primary ? 0xC1 : 0xC0;
+
     uint8_t header[] = {
         0xD5, /* Synch     */
         0xB7, /* JTAG0     */
         0x20, /* JTAG1     */
         0x01, /* JTAG2     */
         0x00, /* JTAG3     */
-        0x01, /* Address1  */
-        0xC1, /* Control   */
+        m_address, /* Address1  */
+        control, /* Control   */
     };
  
     for (uint8_t entry : header) {
@@ -103,6 +275,18 @@ void AnalogChip::to_header_bytestream(std::vector<uint8_t> &data) const {
     }
 }
 
+AnalogModule *AnalogChip::find_cam(std::string_view key) {
+    for (AnalogBlock &cab : m_cabs) {
+        for (auto const &module : cab.modules()) {
+            if (module->key() == key) {
+                return module.get();
+            }
+        }
+    }
+
+    return nullptr;
+}
+
 Channel &AnalogChip::global_input_direct(IOGroup from, AnalogBlock &to, 
                                          Channel::Side side) {
     return m_global_input_direct_channels
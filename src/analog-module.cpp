@@ -1,21 +1,116 @@
 #include "analog-module.hpp"
 #include "util.hpp"
 #include "analog-block.hpp"
+#include "analog-chip.hpp"
 #include "error.hpp"
 #include <sstream>
 
-AnalogModule::AnalogModule(std::string const &name)
-        : m_cab{}, m_name{name},
+AnalogModule::AnalogModule(std::string const &name, 
+                           ParameterTable const &parameters)
+        : m_cab{}, m_name{name}, m_key{}, m_parameters{&parameters},
           m_ins{}, m_caps{}, m_opamps{}, m_comp{}, 
           m_curr_cap{0}, m_n_ins{0} {}
 
-AnalogModule *AnalogModule::Build(std::string_view const &name) {
-    if (name == "GainInv")              return new GainInv();
-    if (name == "SumInv")               return new SumInv();
-    if (name == "Integrator")           return new Integrator();
-    if (name == "GainSwitch")           return new GainSwitch();
-    if (name == "SampleAndHold")        return new SampleAndHold();
-    return nullptr;
+/* Placed in front of every CAM to remember where it was allocated */
+struct alignas(std::max_align_t) AllocationHeader {
+    std::pmr::memory_resource *arena;
+    std::size_t size;
+};
+
+void *AnalogModule::operator new(std::size_t size) {
+    void *p = ::operator new(sizeof(AllocationHeader) + size);
+    new (p) AllocationHeader{ nullptr, size };
+    return static_cast<AllocationHeader *>(p) + 1;
+}
+
+void *AnalogModule::operator new(std::size_t size, 
+                                 std::pmr::memory_resource &arena) {
+    void *p = arena.allocate(sizeof(AllocationHeader) + size, 
+                             alignof(AllocationHeader));
+    new (p) AllocationHeader{ &arena, size };
+    return static_cast<AllocationHeader *>(p) + 1;
+}
+
+void AnalogModule::operator delete(void *p) {
+    if (!p) {
+        return;
+    }
+
+    AllocationHeader *header = static_cast<AllocationHeader *>(p) - 1;
+    if (header->arena) {
+        header->arena->deallocate(header, 
+                                  sizeof(AllocationHeader) + header->size,
+                                  alignof(AllocationHeader));
+    } else {
+        ::operator delete(header);
+    }
+}
+
+void AnalogModule::operator delete(void *p, std::pmr::memory_resource &) {
+    operator delete(p);
+}
+
+struct CamType {
+    std::string_view name;
+    AnalogModule *(*build)(std::pmr::memory_resource *arena);
+};
+
+template <typename T>
+static AnalogModule *build(std::pmr::memory_resource *arena) {
+    return arena ? new (*arena) T() : new T();
+}
+
+static constexpr CamType CamTypeSpecs[] = {
+    { "GainInv",        build<GainInv> },
+    { "SumInv",         build<SumInv> },
+    { "Integrator",     build<Integrator> },
+    { "GainSwitch",     build<GainSwitch> },
+    { "SampleAndHold",  build<SampleAndHold> },
+};
+
+static constexpr NameTable<CamType> CamTypes{CamTypeSpecs};
+
+AnalogModule *AnalogModule::Build(std::string_view const &name,
+                                  std::pmr::memory_resource *arena) {
+    CamType const *type = CamTypes.find(name);
+    return type ? type->build(arena) : nullptr;
+}
+
+int AnalogModule::TypeIndex(std::string_view name) {
+    return CamTypes.index(name);
+}
+
+AnalogModule *AnalogModule::Build(std::size_t type,
+                                  std::pmr::memory_resource *arena) {
+    return type < CamTypes.size() ? CamTypes[type].build(arena) : nullptr;
+}
+
+void AnalogModule::set_parameter(int id, double value) {
+    ParameterSpec const &spec = parameters()[id];
+
+    switch (spec.type) {
+        case ParameterType::Double:
+            break;
+        case ParameterType::Int:
+            value = std::llround(value);
+            break;
+        case ParameterType::Bool:
+            value = std::llround(value) != 0;
+            break;
+    }
+    spec.set(*this, value);
+}
+
+void AnalogModule::update_parameter(int id, double value) {
+    if (is_structural(id)) {
+        std::stringstream ss;
+        ss << "parameter '" << parameters()[id].name << "' of " << m_name 
+           << " cannot be changed after placement";
+        throw DesignError(ss.str());
+    }
+
+    set_parameter(id, value);
+    m_cab->mark_dirty();
 }
 
 InputPort &AnalogModule::in(std::size_t i) {
@@ -78,6 +173,17 @@ void AnalogModule::set_cab(AnalogBlock &cab) {
     m_cab = &cab; 
 }
 
+void AnalogModule::claim_components() {
+    Resources r = resources();
+
+    claim_capacitors(r.capacitors);
+    claim_opamps(r.opamps);
+    if (r.comparators) {
+        claim_comparator();
+    }
+    claim_inputs(r.inputs);
+}
+
 void AnalogModule::claim_inputs(std::size_t n) {
     m_n_ins = n;
     for (std::size_t i = 0; i < n; i++) {
@@ -102,29 +208,27 @@ void AnalogModule::claim_comparator() {
 }
 
 GainInv::GainInv()
-        : AnalogModule{"GainInv"}, m_gain{1.0} {}
+        : AnalogModule{"GainInv", Parameters}, m_gain{1.0} {}
 
 GainInv::GainInv(double gain)
-        : AnalogModule{"GainInv"}, m_gain{gain} {}
+        : AnalogModule{"GainInv", Parameters}, m_gain{gain} {}
 
-bool GainInv::set_parameter(std::string_view param, Parameter value) {
-    if (param == "gain") {
-        m_gain = value.as_double();
-    } else {
-        return false;
-    }
-    return true;
-}
+constexpr ParameterSpec GainInv::ParameterSpecs[] = {
+    { "gain", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<GainInv &>(cam).m_gain = v; } },
+};
 
-void GainInv::claim_components() {
-    claim_capacitors(4);
-    claim_opamps(1);
-    claim_inputs(1);
+constexpr ParameterTable GainInv::Parameters{GainInv::ParameterSpecs};
+
+
+Resources GainInv::resources() const {
+    return { 4, 1, 0, 1 };
 }
 
 void GainInv::finalize() {
     uint8_t num, den;
-    approximate_ratio(m_gain, num, den);
+    approximate_ratio(m_gain, num, den, m_cab->chip().log());
 
     OpAmp &_opamp = opamp(1);
 
@@ -143,32 +247,33 @@ void GainInv::finalize() {
 }
 
 SumInv::SumInv()
-        : AnalogModule{"SumInv"}, m_gains{{1.0, 1.0, 1.0}},
+        : AnalogModule{"SumInv", Parameters}, m_gains{{1.0, 1.0, 1.0}},
           m_n_inputs{2} {}
 
 SumInv::SumInv(double gain1, double gain2, std::size_t n_inputs)
-        : AnalogModule{"SumInv"}, m_gains{{gain1, gain2, 1.0}},
+        : AnalogModule{"SumInv", Parameters}, m_gains{{gain1, gain2, 1.0}},
           m_n_inputs{n_inputs} {}
 
-bool SumInv::set_parameter(std::string_view param, Parameter value) {
-    if (param == "gain1") {
-        m_gains[0] = value.as_double();
-    } else if (param == "gain2") {
-        m_gains[1] = value.as_double();
-    } else if (param == "gain3") {
-        m_gains[2] = value.as_double();
-    } else if (param == "inputs") {
-        m_n_inputs = value.as_int();
-    } else {
-        return false;
-    }
-    return true;
-}
-
-void SumInv::claim_components() {
-    claim_capacitors(2 + 2 * m_n_inputs);
-    claim_opamps(1);
-    claim_inputs(m_n_inputs);
+constexpr ParameterSpec SumInv::ParameterSpecs[] = {
+    { "gain1", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<SumInv &>(cam).m_gains[0] = v; } },
+    { "gain2", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<SumInv &>(cam).m_gains[1] = v; } },
+    { "gain3", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<SumInv &>(cam).m_gains[2] = v; } },
+    { "inputs", ParameterType::Int, true,
+      [](AnalogModule &cam, double v) { 
+          static_cast<SumInv &>(cam).m_n_inputs = v; } },
+};
+
+constexpr ParameterTable SumInv::Parameters{SumInv::ParameterSpecs};
+
+
+Resources SumInv::resources() const {
+    return { 2 + 2 * m_n_inputs, 1, 0, m_n_inputs };
 }
 
 void SumInv::finalize() {
@@ -178,7 +283,7 @@ void SumInv::finalize() {
     }
     std::vector<uint8_t> nums;
     uint8_t den;
-    approximate_ratios(gains, nums, den);
+    approximate_ratios(gains, nums, den, m_cab->chip().log());
 
     OpAmp &_opamp = opamp(1);
 
@@ -199,46 +304,55 @@ void SumInv::finalize() {
 }
 
 Integrator::Integrator()
-        : AnalogModule("Integrator"), 
+        : AnalogModule{"Integrator", Parameters}, 
           m_integ_consts{{4, 1, 1}}, m_invert{{0, 0, 0}}, 
           m_gnd_reset{}, m_n_inputs{1} {}
 
 Integrator::Integrator(double integ_const, bool gnd_reset)
-        : AnalogModule{"Integrator"}, 
+        : AnalogModule{"Integrator", Parameters}, 
           m_integ_consts{{integ_const, 1, 1}}, m_invert{{0, 0, 0}}, 
           m_gnd_reset{gnd_reset},
           m_n_inputs{1} {}
 
-bool Integrator::set_parameter(std::string_view param, Parameter value) {
-    if (param == "integ_const1" || param == "integ_const") {
-        m_integ_consts[0] = value.as_double();
-    } else if (param == "integ_const2") {
-        m_integ_consts[1] = value.as_double();
-    } else if (param == "integ_const3") {
-        m_integ_consts[2] = value.as_double();
-    } else if (param == "invert1" || param == "invert") {
-        m_invert[0] = value.as_bool();
-    } else if (param == "invert2") {
-        m_invert[1] = value.as_bool();
-    } else if (param == "invert3") {
-        m_invert[2] = value.as_bool();
-    } else if (param == "reset") {
-        m_gnd_reset = value.as_bool();
-    } else if (param == "inputs") {
-        m_n_inputs = value.as_int();
-    } else {
-        return false;
-    }
-    return true;
-}
-
-void Integrator::claim_components() {
-    claim_capacitors(1 + m_n_inputs);
-    claim_opamps(1);
-    if (m_gnd_reset) {
-        claim_comparator();
-    }
-    claim_inputs(m_n_inputs);
+/* integ_const and invert are aliases of the parameters of input 1 */
+constexpr ParameterSpec Integrator::ParameterSpecs[] = {
+    { "integ_const1", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_integ_consts[0] = v; } },
+    { "integ_const2", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_integ_consts[1] = v; } },
+    { "integ_const3", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_integ_consts[2] = v; } },
+    { "integ_const", ParameterType::Double, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_integ_consts[0] = v; } },
+    { "invert1", ParameterType::Bool, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_invert[0] = v; } },
+    { "invert2", ParameterType::Bool, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_invert[1] = v; } },
+    { "invert3", ParameterType::Bool, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_invert[2] = v; } },
+    { "invert", ParameterType::Bool, false,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_invert[0] = v; } },
+    { "reset", ParameterType::Bool, true,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_gnd_reset = v; } },
+    { "inputs", ParameterType::Int, true,
+      [](AnalogModule &cam, double v) { 
+          static_cast<Integrator &>(cam).m_n_inputs = v; } },
+};
+
+constexpr ParameterTable Integrator::Parameters{Integrator::ParameterSpecs};
+
+
+Resources Integrator::resources() const {
+    return { 1 + m_n_inputs, 1, m_gnd_reset ? 1u : 0u, m_n_inputs };
 }
 
 void Integrator::finalize() {
@@ -259,7 +373,7 @@ void Integrator::finalize() {
     }
     std::vector<uint8_t> nums;
     uint8_t den;
-    approximate_ratios(k, nums, den);
+    approximate_ratios(k, nums, den, m_cab->chip().log());
 
     if (m_n_inputs == 1) {
         int out_phase = m_invert[0] ? 1 : 2;
@@ -284,15 +398,8 @@ void Integrator::finalize() {
 GainSwitch::GainSwitch()
         : AnalogModule{"GainSwitch"} {}
 
-bool GainSwitch::set_parameter(std::string_view, Parameter) {
-    return false;
-}
-
-void GainSwitch::claim_components() {
-    claim_capacitors(3);
-    claim_opamps(1);
-    claim_comparator();
-    claim_inputs(2);
+Resources GainSwitch::resources() const {
+    return { 3, 1, 1, 2 };
 }
 
 #define TEMP_OPAMP_FEEDBACK_SWITCHING { 0x81, 0x05 }
@@ -318,14 +425,8 @@ void GainSwitch::finalize() {
 SampleAndHold::SampleAndHold()
         : AnalogModule{"SampleAndHold"} {}
 
-bool SampleAndHold::set_parameter(std::string_view, Parameter) {
-    return false;
-}
-
-void SampleAndHold::claim_components() {
-    claim_capacitors(2);
-    claim_opamps(1);
-    claim_inputs(1);
+Resources SampleAndHold::resources() const {
+    return { 2, 1, 0, 1 };
 }
 
 void SampleAndHold::finalize() {
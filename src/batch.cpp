@@ -0,0 +1,66 @@
+#include "batch.hpp"
+#include "thread-pool.hpp"
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <chrono>
+
+std::vector<BatchJob> read_batch_list(std::string const &filename) {
+    std::ifstream file(filename);
+
+    if (!file) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    std::vector<BatchJob> jobs;
+    std::string line;
+    std::size_t lineno = 0;
+
+    while (std::getline(file, line)) {
+        lineno++;
+
+        std::stringstream ss(line);
+        BatchJob job;
+        if (!(ss >> job.infile) || job.infile[0] == '#') {
+            continue;
+        }
+
+        std::string trailing;
+        if (!(ss >> job.outfile) || ss >> trailing) {
+            std::stringstream err;
+            err << filename << ":" << lineno 
+                << ": expected '<infile> <outfile>'";
+            throw std::runtime_error(err.str());
+        }
+
+        jobs.push_back(job);
+    }
+
+    return jobs;
+}
+
+BatchResult run_batch(std::vector<BatchJob> const &jobs, 
+                      std::size_t n_threads,
+                      std::function<void(BatchJob const &)> const &compile) {
+    BatchResult result{ std::vector<std::string>(jobs.size()), 0, 0.0 };
+
+    auto start = std::chrono::steady_clock::now();
+
+    parallel_for(jobs.size(), n_threads, [&](std::size_t i, std::size_t) {
+        try {
+            compile(jobs[i]);
+        } catch (std::exception const &e) {
+            result.errors[i] = e.what();
+        }
+    });
+
+    std::chrono::duration<double> elapsed = 
+            std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+
+    for (std::string const &error : result.errors) {
+        result.n_failed += !error.empty();
+    }
+
+    return result;
+}
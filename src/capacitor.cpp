@@ -83,6 +83,12 @@ Capacitor &Capacitor::claim(AnalogModule &module) {
     return *this;
 }
 
+void Capacitor::release() {
+    m_module = nullptr;
+    m_value = 0x0;
+    m_switch_cfg = {};
+}
+
 Capacitor &Capacitor::set_value(uint8_t value) {
     m_value = value;
 
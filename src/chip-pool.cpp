@@ -0,0 +1,30 @@
+#include "chip-pool.hpp"
+
+ChipPool::ChipPool(std::size_t capacity)
+        : m_capacity{capacity}, m_chips{} {
+    m_chips.reserve(m_capacity);
+    replenish();
+}
+
+std::unique_ptr<AnalogChip> ChipPool::acquire() {
+    if (m_chips.empty()) {
+        return std::make_unique<AnalogChip>();
+    }
+
+    std::unique_ptr<AnalogChip> chip = std::move(m_chips.back());
+    m_chips.pop_back();
+    return chip;
+}
+
+void ChipPool::release(std::unique_ptr<AnalogChip> chip) {
+    if (m_chips.size() < m_capacity) {
+        chip->reset();
+        m_chips.push_back(std::move(chip));
+    }
+}
+
+void ChipPool::replenish() {
+    while (m_chips.size() < m_capacity) {
+        m_chips.push_back(std::make_unique<AnalogChip>());
+    }
+}
@@ -18,6 +18,12 @@ Comparator &Comparator::claim(AnalogModule &module) {
     return *this;
 }
 
+void Comparator::release() {
+    m_module = nullptr;
+    m_cfg = {};
+    m_in.disconnect();
+}
+
 Comparator &Comparator::set_configuration(std::array<uint8_t, 2> cfg) {
     m_cfg = cfg;
 
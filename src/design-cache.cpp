@@ -0,0 +1,377 @@
+#include "design-cache.hpp"
+#include "time-report.hpp"
+#include <stdexcept>
+#include <algorithm>
+#include <cstring>
+
+enum class CacheOp : uint8_t {
+    Chip = 1,   /* Starts a new chip */
+    Address,    /* u8 address */
+    IOMode,     /* u8 cell, u8 mode */
+    CabSetup,   /* u8 cab, u8 clock A, u8 clock B (0 is the null clock) */
+    Cam,        /* u8 cab, u8 CAM type index, string key */
+    Parameter,  /* u8 parameter ID, f64 value of the last CAM */
+    Claim,      /* claims the components of the last CAM */
+    Output,     /* u16 ref, u8 port */
+    Input,      /* u16 ref, u8 port, connected to the last output */
+};
+
+/* FNV-1a, 32 bit */
+static uint32_t checksum(uint8_t const *data, std::size_t size) {
+    uint32_t hash = 0x811C9DC5;
+    for (std::size_t i = 0; i < size; i++) {
+        hash = (hash ^ data[i]) * 0x01000193;
+    }
+    return hash;
+}
+
+static void put_u32(uint8_t *p, uint32_t value) {
+    for (std::size_t i = 0; i < 4; i++) {
+        p[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+static uint32_t get_u32(uint8_t const *p) {
+    uint32_t value = 0;
+    for (std::size_t i = 0; i < 4; i++) {
+        value |= static_cast<uint32_t>(p[i]) << (8 * i);
+    }
+    return value;
+}
+
+DesignCacheWriter::DesignCacheWriter()
+        : m_payload{}, m_refs{} {}
+
+void DesignCacheWriter::chip(AnalogChip &chip) {
+    put(static_cast<uint8_t>(CacheOp::Chip));
+
+    m_refs.clear();
+    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+        m_refs[&chip.io_cell(i)] = m_refs.size();
+    }
+}
+
+void DesignCacheWriter::address(uint8_t address) {
+    put(static_cast<uint8_t>(CacheOp::Address));
+    put(address);
+}
+
+void DesignCacheWriter::io_mode(int cell, IOMode mode) {
+    put(static_cast<uint8_t>(CacheOp::IOMode));
+    put(cell);
+    put(static_cast<uint8_t>(mode));
+}
+
+void DesignCacheWriter::cab_setup(int cab, int clk_a, int clk_b) {
+    put(static_cast<uint8_t>(CacheOp::CabSetup));
+    put(cab);
+    put(clk_a);
+    put(clk_b);
+}
+
+void DesignCacheWriter::cam(AnalogModule const *cam, int cab,
+                            std::string_view name, std::string_view key) {
+    put(static_cast<uint8_t>(CacheOp::Cam));
+    put(cab);
+    put(AnalogModule::TypeIndex(name));
+    put_string(key);
+
+    m_refs[cam] = m_refs.size();
+}
+
+void DesignCacheWriter::parameter(int id, double value) {
+    put(static_cast<uint8_t>(CacheOp::Parameter));
+    put(id);
+
+    uint64_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    for (std::size_t i = 0; i < 8; i++) {
+        put(static_cast<uint8_t>(bits >> (8 * i)));
+    }
+}
+
+void DesignCacheWriter::claim() {
+    put(static_cast<uint8_t>(CacheOp::Claim));
+}
+
+void DesignCacheWriter::output(AnalogModule const *cam, std::size_t port) {
+    put(static_cast<uint8_t>(CacheOp::Output));
+    put_ref(cam);
+    put(port);
+}
+
+void DesignCacheWriter::input(AnalogModule const *cam, std::size_t port) {
+    put(static_cast<uint8_t>(CacheOp::Input));
+    put_ref(cam);
+    put(port);
+}
+
+std::vector<uint8_t> DesignCacheWriter::finish() const {
+    std::vector<uint8_t> blob(design_cache::HeaderSize + m_payload.size());
+
+    std::memcpy(blob.data(), design_cache::Magic, 4);
+    put_u32(&blob[4], design_cache::Version);
+    put_u32(&blob[8], m_payload.size());
+    put_u32(&blob[12], checksum(m_payload.data(), m_payload.size()));
+
+    std::copy(m_payload.begin(), m_payload.end(), 
+              blob.begin() + design_cache::HeaderSize);
+    return blob;
+}
+
+void DesignCacheWriter::put(uint8_t value) {
+    m_payload.push_back(value);
+}
+
+void DesignCacheWriter::put_string(std::string_view s) {
+    if (s.size() > 0xFF) {
+        throw std::runtime_error("name too long for design cache: "
+                                 + std::string(s));
+    }
+    put(s.size());
+    m_payload.insert(m_payload.end(), s.begin(), s.end());
+}
+
+void DesignCacheWriter::put_ref(AnalogModule const *cam) {
+    uint16_t ref = m_refs.at(cam);
+    put(ref);
+    put(ref >> 8);
+}
+
+ChipVariant ChipVariant::Identity() {
+    ChipVariant variant;
+    for (int i = 0; i <= NBlocksPerChip; i++) {
+        variant.cabs[i] = i;
+    }
+    for (int i = 0; i <= NType1IOCellsPerChip; i++) {
+        variant.io_cells[i] = i;
+    }
+    return variant;
+}
+
+bool is_design_cache(std::string_view data) {
+    return data.size() >= design_cache::HeaderSize
+        && std::memcmp(data.data(), design_cache::Magic, 4) == 0;
+}
+
+/* Bounds-checked reading of the journal */
+class CacheReader {
+public:
+    CacheReader(uint8_t const *data, std::size_t size,
+                std::string const &name)
+            : m_data{data}, m_size{size}, m_pos{}, m_name{name} {}
+
+    bool at_end() const { return m_pos == m_size; }
+
+    uint8_t get() {
+        require(1);
+        return m_data[m_pos++];
+    }
+
+    uint16_t get_u16() {
+        uint16_t lo = get();
+        return lo | static_cast<uint16_t>(get()) << 8;
+    }
+
+    double get_double() {
+        require(8);
+        uint64_t bits = 0;
+        for (std::size_t i = 0; i < 8; i++) {
+            bits |= static_cast<uint64_t>(m_data[m_pos++]) << (8 * i);
+        }
+
+        double value;
+        std::memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    std::string_view get_string() {
+        std::size_t size = get();
+        require(size);
+        char const *p = reinterpret_cast<char const *>(m_data + m_pos);
+        m_pos += size;
+        return std::string_view(p, size);
+    }
+
+    [[noreturn]] void error(std::string const &s) const {
+        throw std::runtime_error(m_name + ": corrupt design cache: " + s);
+    }
+
+private:
+    void require(std::size_t n) const {
+        if (m_size - m_pos < n) {
+            error("truncated");
+        }
+    }
+
+    uint8_t const *m_data;
+    std::size_t m_size;
+    std::size_t m_pos;
+    std::string const &m_name;
+};
+
+std::vector<std::unique_ptr<AnalogChip>> load_design_cache(
+        std::string_view blob, std::string const &name, ChipPool *pool,
+        ChipVariant const *variant) {
+    PhaseTimer timer(Phase::LoadDesignCache);
+
+    auto data = reinterpret_cast<uint8_t const *>(blob.data());
+    if (!is_design_cache(blob)) {
+        throw std::runtime_error(name + ": not a design cache");
+    }
+    if (get_u32(data + 4) != design_cache::Version) {
+        throw std::runtime_error(name + ": design cache of another version");
+    }
+
+    std::size_t size = get_u32(data + 8);
+    CacheReader reader(data + design_cache::HeaderSize, size, name);
+    if (blob.size() - design_cache::HeaderSize != size) {
+        reader.error("size mismatch");
+    }
+    if (checksum(data + design_cache::HeaderSize, size)
+        != get_u32(data + 12)) {
+        reader.error("checksum mismatch");
+    }
+
+    std::vector<std::unique_ptr<AnalogChip>> chips;
+    std::vector<AnalogModule *> refs;
+    AnalogModule *cam = nullptr;
+    OutputPort *out = nullptr;
+
+    auto chip = [&]() -> AnalogChip & {
+        if (chips.empty()) {
+            reader.error("step outside of a chip");
+        }
+        return *chips.back();
+    };
+    auto last_cam = [&]() -> AnalogModule & {
+        if (!cam) {
+            reader.error("step outside of a CAM");
+        }
+        return *cam;
+    };
+    ChipVariant const identity = ChipVariant::Identity();
+    if (!variant) {
+        variant = &identity;
+    }
+    auto load_cab = [&]() -> AnalogBlock & {
+        return chip().cab(variant->cabs.at(reader.get()));
+    };
+
+    auto ref = [&]() -> AnalogModule & {
+        std::size_t i = reader.get_u16();
+        if (i >= refs.size()) {
+            reader.error("reference to undeclared CAM");
+        }
+        return *refs[i];
+    };
+
+    try {
+        while (!reader.at_end()) {
+            switch (static_cast<CacheOp>(reader.get())) {
+                case CacheOp::Chip:
+                    chips.push_back(pool ? pool->acquire()
+                                         : std::make_unique<AnalogChip>());
+                    refs.clear();
+                    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+                        refs.push_back(
+                                &chip().io_cell(variant->io_cells[i]));
+                    }
+                    for (int i = 1; i <= NBlocksPerChip; i++) {
+                        chip().cab(i).set_opamps_reversed(
+                                variant->reversed_opamps[i]);
+                    }
+                    cam = nullptr;
+                    out = nullptr;
+                    break;
+
+                case CacheOp::Address:
+                    chip().set_address(reader.get());
+                    break;
+
+                case CacheOp::IOMode: {
+                    IOCell &cell = 
+                            chip().io_cell(variant->io_cells.at(reader.get()));
+                    uint8_t mode = reader.get();
+                    if (mode != static_cast<uint8_t>(IOMode::Disabled)
+                        && mode != static_cast<uint8_t>(IOMode::InputBypass)
+                        && mode != static_cast<uint8_t>(IOMode::OutputBypass)) {
+                        reader.error("unknown IO mode");
+                    }
+                    cell.set_mode(static_cast<IOMode>(mode));
+                    break;
+                }
+
+                case CacheOp::CabSetup: {
+                    AnalogBlock &cab = load_cab();
+                    uint8_t ids[2] = { reader.get(), reader.get() };
+
+                    Clock *clocks[2];
+                    for (std::size_t i = 0; i < 2; i++) {
+                        clocks[i] = ids[i] ? &chip().clock(ids[i])
+                                           : &chip().null_clock();
+                    }
+                    cab.setup(*clocks[0], *clocks[1]);
+                    break;
+                }
+
+                case CacheOp::Cam: {
+                    AnalogBlock &cab = load_cab();
+                    std::size_t type = reader.get();
+
+                    cam = AnalogModule::Build(type, &cab.chip().arena());
+                    if (!cam) {
+                        reader.error("unknown CAM type");
+                    }
+                    cab.add_raw(cam);
+                    cam->set_key(reader.get_string());
+                    refs.push_back(cam);
+                    break;
+                }
+
+                case CacheOp::Parameter: {
+                    std::size_t id = reader.get();
+                    double value = reader.get_double();
+                    if (id >= last_cam().parameters().size()) {
+                        reader.error("unknown parameter");
+                    }
+                    cam->set_parameter(id, value);
+                    break;
+                }
+
+                case CacheOp::Claim: {
+                    PhaseTimer claim_timer(Phase::ClaimComponents);
+                    last_cam().claim_components();
+                    break;
+                }
+
+                case CacheOp::Output: {
+                    AnalogModule &from = ref();
+                    out = &from.out(reader.get());
+                    break;
+                }
+
+                case CacheOp::Input: {
+                    AnalogModule &to = ref();
+                    uint8_t port = reader.get();
+                    if (!out) {
+                        reader.error("input without output");
+                    }
+                    out->connect(port == design_cache::ComparatorPort
+                                 ? to.comp().in() : to.in(port));
+                    break;
+                }
+
+                default:
+                    reader.error("unknown step");
+            }
+        }
+    } catch (std::out_of_range const &) {
+        reader.error("index out of range");
+    }
+
+    if (chips.empty()) {
+        reader.error("no chips");
+    }
+    return chips;
+}
@@ -0,0 +1,341 @@
+#include "document.hpp"
+#include "parser.hpp"
+#include "error.hpp"
+#include <algorithm>
+#include <sstream>
+#include <unordered_set>
+#include <cstdint>
+
+Document::Document(std::string const &name)
+        : m_name{name}, m_text{}, m_lexer{}, m_tokens{}, m_lex_error{},
+          m_decls{}, m_removed{}, m_n_elaborated{} {
+    update(0, 0, 0);
+}
+
+void Document::set_text(std::string text) {
+    std::size_t old_end = m_text.size();
+    m_text = std::move(text);
+    update(0, old_end, m_text.size());
+}
+
+void Document::edit(std::size_t begin, std::size_t end,
+                    std::string_view text) {
+    end = std::min(end, m_text.size());
+    begin = std::min(begin, end);
+
+    m_text.replace(begin, end - begin, text);
+    update(begin, end, begin + text.size());
+}
+
+void Document::update(std::size_t begin, std::size_t old_end,
+                      std::size_t new_end) {
+    m_lexer.open_view(m_text, m_name);
+
+    try {
+        relex(begin, old_end, new_end);
+        m_lex_error.reset();
+    } catch (SourceError const &e) {
+        /* Offsets are unknown until the text can be lexed again, so the
+           next edit starts over */
+        m_tokens.clear();
+        m_decls.clear();
+        m_lex_error.reset(new Diagnostic{
+                Diagnostic::Error, e.offset(), e.reason() });
+        m_n_elaborated = 0;
+        return;
+    }
+
+    std::vector<Declaration> decls = segment();
+    match(decls, begin, old_end, new_end);
+    elaborate();
+}
+
+/* Lexes the edited range again, starting at the token in front of it
+   (or at the start of the text, as the edit may lie in a comment before
+   the first token), until a token starts where a token started before
+   the edit. As the lexer carries no state between tokens, the remaining
+   tokens are the previous ones, shifted by the change in length. */
+void Document::relex(std::size_t begin, std::size_t old_end,
+                     std::size_t new_end) {
+    int64_t delta = static_cast<int64_t>(new_end) - old_end;
+
+    auto first = std::lower_bound(m_tokens.begin(), m_tokens.end(), begin,
+            [](Token const &token, std::size_t offset) {
+                return token.offset() + token.length() < offset;
+            });
+    std::size_t i = first - m_tokens.begin();
+
+    std::size_t start = 0;
+    if (i > 0) {
+        start = m_tokens[--i].offset();
+    }
+
+    std::vector<Token> tokens(m_tokens.begin(), m_tokens.begin() + i);
+    m_lexer.seek(start);
+
+    std::size_t j = i;
+    while (true) {
+        Token token = m_lexer.next();
+        if (token.type() == TokenType::EndOfFile) {
+            tokens.push_back(token);
+            break;
+        }
+
+        if (token.offset() >= new_end) {
+            while (j < m_tokens.size()
+                   && (m_tokens[j].offset() < old_end
+                       || m_tokens[j].offset() + delta < token.offset())) {
+                j++;
+            }
+
+            if (j < m_tokens.size()
+                && m_tokens[j].type() != TokenType::EndOfFile
+                && m_tokens[j].offset() + delta == token.offset()) {
+                for (; j < m_tokens.size(); j++) {
+                    Token const &old = m_tokens[j];
+                    tokens.emplace_back(old.type(), old.offset() + delta,
+                                        old.length());
+                }
+                break;
+            }
+        }
+
+        tokens.push_back(token);
+    }
+
+    m_tokens = std::move(tokens);
+}
+
+/* Splits the tokens into top-level declarations: a let up to its
+   semicolon (or the next declaration), a chip up to its closing brace.
+   Anything else runs up to the next declaration and fails to parse. */
+std::vector<Document::Declaration> Document::segment() const {
+    std::vector<Declaration> decls;
+
+    std::size_t i = 0;
+    auto type = [&]() { return m_tokens[i].type(); };
+    auto at_eof = [&]() { return type() == TokenType::EndOfFile; };
+
+    while (!at_eof()) {
+        std::size_t first = i;
+        TokenType kind = type();
+
+        if (kind == TokenType::Let) {
+            i++;
+            while (!at_eof() && type() != TokenType::Semicolon
+                   && type() != TokenType::Let && type() != TokenType::Chip) {
+                i++;
+            }
+            if (type() == TokenType::Semicolon) {
+                i++;
+            }
+        } else if (kind == TokenType::Chip) {
+            i++;
+            for (int depth = 0; !at_eof()
+                                && (depth > 0 || type() == TokenType::LBrace);
+                 i++) {
+                if (type() == TokenType::LBrace) {
+                    depth++;
+                } else if (type() == TokenType::RBrace && --depth == 0) {
+                    i++;
+                    break;
+                }
+            }
+        } else {
+            kind = TokenType::None;
+            while (!at_eof() && type() != TokenType::Let
+                   && type() != TokenType::Chip) {
+                i++;
+            }
+        }
+
+        Token const &last = m_tokens[i - 1];
+
+        Declaration decl = {};
+        decl.kind = kind;
+        decl.begin = m_tokens[first].offset();
+        decl.end = last.offset() + last.length();
+        decl.stale = true;
+        decls.push_back(std::move(decl));
+    }
+
+    return decls;
+}
+
+/* Takes over the declarations that lie entirely before or after the
+   edited range and marks the others as stale */
+void Document::match(std::vector<Declaration> &decls, std::size_t begin,
+                     std::size_t old_end, std::size_t new_end) {
+    int64_t delta = static_cast<int64_t>(new_end) - old_end;
+    std::size_t k = 0;
+
+    m_removed.clear();
+
+    for (Declaration &decl : decls) {
+        int64_t wanted = -1;
+        if (decl.end <= begin) {
+            wanted = decl.begin;
+        } else if (decl.begin >= new_end) {
+            wanted = decl.begin - delta;
+        }
+
+        while (k < m_decls.size()
+               && static_cast<int64_t>(m_decls[k].begin) < wanted) {
+            m_removed.push_back(std::move(m_decls[k++]));
+        }
+
+        Declaration *old = k < m_decls.size() ? &m_decls[k] : nullptr;
+        if (wanted >= 0 && old && old->kind == decl.kind
+            && static_cast<int64_t>(old->begin) == wanted
+            && old->end - old->begin == decl.end - decl.begin
+            && (decl.end <= begin || old->begin >= old_end)) {
+            old->begin = decl.begin;
+            old->end = decl.end;
+            old->stale = false;
+            decl = std::move(*old);
+            k++;
+            continue;
+        }
+
+        /* A new declaration may use any of its identifiers */
+        auto token = std::lower_bound(m_tokens.begin(), m_tokens.end(),
+                decl.begin, [](Token const &t, std::size_t offset) {
+                    return t.offset() < offset;
+                });
+        for (bool first = true; token->type() != TokenType::EndOfFile
+                                && token->offset() < decl.end; token++) {
+            if (token->type() != TokenType::Identifier) {
+                continue;
+            }
+
+            std::string_view lexeme = m_lexer.source().lexeme(*token);
+            if (first && decl.kind == TokenType::Let) {
+                decl.name = lexeme;
+            }
+            first = false;
+            decl.identifiers.emplace_back(lexeme);
+        }
+    }
+
+    for (; k < m_decls.size(); k++) {
+        m_removed.push_back(std::move(m_decls[k]));
+    }
+
+    m_decls = std::move(decls);
+}
+
+void Document::elaborate() {
+    Parser parser;
+
+    /* Constants whose value changed, or that were (un)defined */
+    std::unordered_set<std::string_view> changed;
+    for (Declaration const &decl : m_removed) {
+        if (decl.kind == TokenType::Let && decl.defined) {
+            changed.insert(decl.name);
+        }
+    }
+
+    m_n_elaborated = 0;
+    std::size_t n_chips = 0;
+
+    for (Declaration &decl : m_decls) {
+        bool stale = decl.stale
+            || (decl.kind == TokenType::Chip && decl.index != n_chips);
+        for (std::size_t i = 0; !stale && !changed.empty()
+                                && i < decl.identifiers.size(); i++) {
+            stale = changed.count(decl.identifiers[i]);
+        }
+
+        if (!stale) {
+            if (decl.kind == TokenType::Let && decl.defined) {
+                parser.define(decl.name, decl.value);
+            }
+            n_chips += decl.kind == TokenType::Chip;
+            continue;
+        }
+
+        m_n_elaborated++;
+        decl.stale = false;
+        decl.failed = false;
+
+        bool was_defined = decl.defined;
+        double old_value = decl.value;
+        decl.defined = false;
+        decl.chip.reset();
+        decl.resources.clear();
+
+        try {
+            if (decl.kind == TokenType::Chip) {
+                decl.index = n_chips++;
+            }
+
+            auto chip = parser.parse_declaration(m_lexer, decl.begin,
+                                                 decl.index);
+
+            if (decl.kind == TokenType::Let) {
+                decl.defined = true;
+                decl.value = *parser.find_constant(decl.name);
+            } else if (chip) {
+                std::stringstream ss;
+                for (int id = 1; id <= NBlocksPerChip; id++) {
+                    if (!chip->cab(id).modules().empty()) {
+                        ss << "cab " << id << ": ";
+                        chip->cab(id).log_resources(ss);
+                    }
+                }
+                decl.resources = ss.str();
+                if (!decl.resources.empty()) {
+                    decl.resources.pop_back();
+                }
+
+                chip->compile();
+                decl.chip = std::move(chip);
+            }
+        } catch (SourceError const &e) {
+            decl.failed = true;
+            decl.error_offset = e.offset() >= decl.begin
+                                ? e.offset() - decl.begin : 0;
+            decl.error = e.reason();
+        } catch (std::exception const &e) {
+            decl.failed = true;
+            decl.error_offset = 0;
+            decl.error = e.what();
+        }
+
+        if (decl.kind == TokenType::Let
+            && (decl.defined != was_defined
+                || (decl.defined && decl.value != old_value))) {
+            changed.insert(decl.name);
+        }
+    }
+}
+
+std::vector<Diagnostic> Document::diagnostics() const {
+    std::vector<Diagnostic> result;
+
+    if (m_lex_error) {
+        result.push_back(*m_lex_error);
+    }
+
+    for (Declaration const &decl : m_decls) {
+        if (decl.failed) {
+            result.push_back({ Diagnostic::Error,
+                               decl.begin + decl.error_offset, decl.error });
+        } else if (decl.kind == TokenType::Chip && !decl.resources.empty()) {
+            result.push_back({ Diagnostic::Information, decl.begin,
+                               decl.resources });
+        }
+    }
+
+    return result;
+}
+
+std::vector<AnalogChip const *> Document::chips() const {
+    std::vector<AnalogChip const *> result;
+    for (Declaration const &decl : m_decls) {
+        if (decl.kind == TokenType::Chip) {
+            result.push_back(decl.chip.get());
+        }
+    }
+    return result;
+}
@@ -0,0 +1,251 @@
+#include "explore.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "chip-pool.hpp"
+#include "thread-pool.hpp"
+#include "time-report.hpp"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <random>
+#include <stdexcept>
+#include <unordered_set>
+#include <vector>
+
+/* The costs of a variant are packed into a word, most significant first,
+   so that the best variant is the one with the least word and can be
+   kept in an atomic. The index of the variant breaks ties. */
+static constexpr int IndexBits = 24;
+static constexpr int ClockBits = 4;
+static constexpr int ByteBits = 24;
+
+static uint64_t pack_cost(VariantCost const &cost, uint64_t index) {
+    return cost.n_channels << (ByteBits + ClockBits + IndexBits)
+         | cost.n_bytes << (ClockBits + IndexBits)
+         | cost.n_clocks << IndexBits
+         | index;
+}
+
+static VariantCost variant_cost(AnalogChip const &chip,
+                                CompileResult const &result) {
+    return { chip.n_used_channels(), result.bytestream.size(),
+             chip.n_used_clocks() };
+}
+
+static std::size_t cost_index(uint64_t cost) {
+    return cost & ((uint64_t{1} << IndexBits) - 1);
+}
+
+/* Thrown from CompileOptions::routed to give up on a variant */
+struct Pruned {};
+
+/* Maps the used IDs to the first of perm and the unused IDs, in order, to
+   the IDs that are left */
+template <std::size_t N>
+static void renumber(std::array<int, N + 1> &ids, std::vector<int> const &used,
+                     std::array<int, N> const &perm) {
+    std::array<bool, N + 1> taken{};
+    std::array<bool, N + 1> is_used{};
+    for (std::size_t k = 0; k < used.size(); k++) {
+        ids[used[k]] = perm[k];
+        taken[perm[k]] = true;
+        is_used[used[k]] = true;
+    }
+
+    int next = 1;
+    for (std::size_t id = 1; id <= N; id++) {
+        if (is_used[id]) {
+            continue;
+        }
+        while (taken[next]) {
+            next++;
+        }
+        ids[id] = next++;
+    }
+}
+
+static uint32_t variant_key(ChipVariant const &variant) {
+    uint32_t key = 0;
+    for (int i = 1; i <= NBlocksPerChip; i++) {
+        key = key << 2 | (variant.cabs[i] - 1);
+    }
+    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+        key = key << 2 | (variant.io_cells[i] - 1);
+    }
+    return key << (NBlocksPerChip + 1) | variant.reversed_opamps.to_ulong();
+}
+
+/* The distinct variants of the chip: the used CABs and IO cells on any
+   others, and any of the CABs with op-amps in use reversed. The design
+   itself comes first, the others in a fixed pseudo-random order, so that
+   exploring fewer than all of them samples all kinds of changes. */
+static std::vector<ChipVariant> variants_of(AnalogChip &chip) {
+    std::vector<int> cabs, cells, opamp_cabs;
+    for (int i = 1; i <= NBlocksPerChip; i++) {
+        AnalogBlock &cab = chip.cab(i);
+        if (cab.is_set_up()) {
+            cabs.push_back(i);
+        }
+        if (cab.available().opamps < NOpAmpsPerBlock) {
+            opamp_cabs.push_back(i);
+        }
+    }
+    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+        if (chip.io_cell(i).mode() != IOMode::Disabled) {
+            cells.push_back(i);
+        }
+    }
+
+    std::vector<ChipVariant> variants = { ChipVariant::Identity() };
+    std::unordered_set<uint32_t> seen = { variant_key(variants[0]) };
+
+    std::array<int, NBlocksPerChip> cab_perm = { 1, 2, 3, 4 };
+    do {
+        std::array<int, NType1IOCellsPerChip> cell_perm = { 1, 2, 3, 4 };
+        do {
+            for (unsigned mask = 0; mask < 1u << opamp_cabs.size(); mask++) {
+                ChipVariant variant = ChipVariant::Identity();
+                renumber(variant.cabs, cabs, cab_perm);
+                renumber(variant.io_cells, cells, cell_perm);
+                for (std::size_t k = 0; k < opamp_cabs.size(); k++) {
+                    if (mask >> k & 1) {
+                        variant.reversed_opamps.set(
+                                variant.cabs[opamp_cabs[k]]);
+                    }
+                }
+
+                if (seen.insert(variant_key(variant)).second) {
+                    variants.push_back(variant);
+                }
+            }
+        } while (std::next_permutation(cell_perm.begin(), cell_perm.end()));
+    } while (std::next_permutation(cab_perm.begin(), cab_perm.end()));
+
+    /* Fisher-Yates on the generator alone, as std::shuffle is not
+       specified exactly */
+    std::mt19937 rng(1);
+    for (std::size_t i = variants.size() - 1; i > 1; i--) {
+        std::size_t j = 1 + rng() % i;
+        std::swap(variants[i], variants[j]);
+    }
+
+    return variants;
+}
+
+ExploreResult run_explore(std::string_view source,
+                          CompileOptions const &options,
+                          std::size_t n_variants, std::size_t n_threads) {
+    /* Variants are built by renumbering while loading a design cache */
+    std::vector<uint8_t> blob;
+    std::string_view cache = source;
+    if (!is_design_cache(source)) {
+        DesignCacheWriter writer;
+        Parser parser;
+        parser.set_cache(&writer);
+
+        Lexer lexer;
+        lexer.open_view(source, options.name);
+        parser.parse_chips(lexer);
+
+        blob = writer.finish();
+        cache = std::string_view(reinterpret_cast<char const *>(blob.data()),
+                                 blob.size());
+    }
+
+    auto design = load_design_cache(cache, options.name);
+    if (design.size() != 1) {
+        throw std::runtime_error(options.name + ": --explore requires a "
+                                 "design with a single chip");
+    }
+
+    std::vector<ChipVariant> variants = variants_of(*design[0]);
+    std::size_t n_possible = variants.size();
+    variants.resize(std::min(n_possible, std::max<std::size_t>(n_variants, 1)));
+
+    std::vector<ChipPool> pools;
+    pools.reserve(n_threads);
+    for (std::size_t w = 0; w < n_threads; w++) {
+        pools.emplace_back(1);
+    }
+
+    std::atomic<uint64_t> best{UINT64_MAX};
+    std::atomic<std::size_t> n_failed{0};
+    std::atomic<std::size_t> n_pruned{0};
+    VariantCost design_cost{};
+    std::string design_error;
+
+    auto start = std::chrono::steady_clock::now();
+    TimeReport *report = TimeReport::current();
+
+    parallel_for(variants.size(), n_threads, [&](std::size_t i,
+                                                 std::size_t w) {
+        ScopedTimeReport scope(report);
+
+        /* The design itself is compiled to completion for the summary */
+        CompileOptions variant_options;
+        variant_options.name = options.name;
+        if (i > 0) {
+            variant_options.routed = [&](AnalogChip &chip) {
+                uint64_t bound = pack_cost({ chip.n_used_channels(), 0, 0 },
+                                           0);
+                if (bound > best.load(std::memory_order_relaxed)) {
+                    throw Pruned();
+                }
+            };
+        }
+
+        std::vector<std::unique_ptr<AnalogChip>> chips;
+        try {
+            chips = load_design_cache(cache, options.name, &pools[w],
+                                      &variants[i]);
+            AnalogChip &chip = *chips[0];
+            CompileResult result = compile_chip(chip, variant_options);
+
+            uint64_t cost = pack_cost(variant_cost(chip, result), i);
+            if (i == 0) {
+                design_cost = variant_cost(chip, result);
+            }
+
+            uint64_t current = best.load(std::memory_order_relaxed);
+            while (cost < current
+                   && !best.compare_exchange_weak(current, cost,
+                                                  std::memory_order_relaxed)) {}
+        } catch (Pruned const &) {
+            n_pruned++;
+        } catch (std::exception const &e) {
+            n_failed++;
+            if (i == 0) {
+                design_error = e.what();
+            }
+        }
+
+        for (auto &chip : chips) {
+            pools[w].release(std::move(chip));
+        }
+    });
+
+    std::chrono::duration<double> elapsed =
+            std::chrono::steady_clock::now() - start;
+
+    if (best == UINT64_MAX) {
+        throw std::runtime_error(design_error);
+    }
+
+    ExploreResult explored;
+    explored.index = cost_index(best);
+    explored.variant = variants[explored.index];
+    explored.chip = std::move(load_design_cache(cache, options.name, nullptr,
+                                                &explored.variant)[0]);
+    explored.result = compile_chip(*explored.chip, options);
+    explored.cost = variant_cost(*explored.chip, explored.result);
+
+    explored.n_variants = variants.size();
+    explored.n_possible = n_possible;
+    explored.n_failed = n_failed;
+    explored.n_pruned = n_pruned;
+    explored.seconds = elapsed.count();
+    explored.design_cost = design_cost;
+    explored.design_error = design_error;
+
+    return explored;
+}
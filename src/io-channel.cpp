@@ -2,15 +2,17 @@
 #include "io-port.hpp"
 #include "analog-block.hpp"
 #include "io-cell.hpp"
+#include "routing-state.hpp"
+#include "time-report.hpp"
 #include <sstream>
 #include <stdexcept>
 #include <cassert>
 
 Channel::Channel()
-        : type{}, side{}, driver{nullptr} {}
+        : type{}, side{}, state{}, id{} {}
 
 Channel::Channel(Channel::Type type, Channel::Side side)
-        : type{type}, side{side}, driver{nullptr} {}
+        : type{type}, side{side}, state{}, id{} {}
 
 Channel Channel::IntraCab(Side side) {
     return Channel(Channel::Type::IntraCab, side);
@@ -146,12 +148,23 @@ Channel::Side Channel::source_to_side(OutPortSource source) {
     }
 }
 
+void Channel::bind(RoutingState &state, std::size_t id) {
+    assert(id < RoutingState::MaxChannels);
+
+    this->state = &state;
+    this->id = id;
+}
+
+OutputPort *Channel::driver() const {
+    return state ? state->driver(id) : nullptr;
+}
+
 bool Channel::available(PortLink &link) {
     if (allocated_for(link)) {
         return true;
     }
 
-    if (driver == nullptr) {
+    if (driver() == nullptr) {
         return true;
     }
 
@@ -159,13 +172,16 @@ bool Channel::available(PortLink &link) {
 }
 
 bool Channel::allocated_for(PortLink &link) {
-    return driver == link.out;
+    return driver() == link.out;
 }
 
 Channel &Channel::allocate(PortLink &link) {
+    assert(state);
+
     if (available(link)) {
         link.channels.push_back(this);
-        driver = link.out;
+        state->set_driver(id, link.out);
+        report_count(Counter::ChannelsAllocated);
     } else {
         std::stringstream ss;
         ss << "Cannot allocate Channel " << *this << " for Link " << link;
@@ -176,8 +192,10 @@ Channel &Channel::allocate(PortLink &link) {
 }
 
 Channel &Channel::reserve(OutputPort &out) {
-    if (driver == nullptr || driver == &out) {
-        driver = &out;
+    assert(state);
+
+    if (driver() == nullptr || driver() == &out) {
+        state->set_driver(id, &out);
     } else {
         std::stringstream ss;
         ss << "Cannot reserve Channel " << *this << " for Port " << out;
@@ -187,19 +205,31 @@ Channel &Channel::reserve(OutputPort &out) {
     return *this;
 }
 
+void Channel::release() {
+    if (state) {
+        state->set_driver(id, nullptr);
+    }
+
+    if (type == Channel::Type::LocalInput) {
+        data.local_input.source = nullptr;
+    } else if (type == Channel::Type::LocalOutput) {
+        data.local_output.dest = nullptr;
+    }
+}
+
 void Channel::set_local_input_source(Channel &source) {
     assert(type == Channel::Type::LocalInput);
     assert(source.type == Channel::Type::GlobalBiIndirect);
-    assert(source.driver != nullptr);
+    assert(source.driver() != nullptr);
 
     data.local_input.source = &source;
 }
 
 void Channel::set_local_output_dest(Channel &dest) {
-    assert(driver != nullptr);
+    assert(driver() != nullptr);
     assert(type == Channel::Type::LocalOutput);
     assert(dest.type == Channel::Type::GlobalBiIndirect);
-    assert(dest.driver == driver);
+    assert(dest.driver() == driver());
 
     data.local_output.dest = &dest;
 }
@@ -543,8 +573,8 @@ std::ostream &operator <<(std::ostream &os, Channel const &channel) {
     }
     os << "]";
 
-    if (channel.driver) {
-        os << " (>>> " << *channel.driver << ")";
+    if (OutputPort *driver = channel.driver()) {
+        os << " (>>> " << *driver << ")";
     }
     return os;
 }
@@ -1,6 +1,7 @@
 #include "io-port.hpp"
 #include "analog-module.hpp"
 #include "analog-block.hpp"
+#include "analog-chip.hpp"
 #include "io-cell.hpp"
 #include "error.hpp"
 #include <sstream>
@@ -26,11 +27,18 @@ char const *to_string(OutPortSource source) {
     return "";
 }
 
+void ChannelPath::push_back(Channel *channel) {
+    if (m_size == MaxChannels) {
+        throw std::runtime_error("route through too many channels");
+    }
+    m_channels[m_size++] = channel;
+}
+
 PortLink::PortLink() 
-        : in{nullptr}, out{nullptr}, channels{} {}
+        : in{nullptr}, out{nullptr}, channels{}, next{nullptr} {}
 
 PortLink::PortLink(InputPort *in, OutputPort *out)
-        : in{in}, out{out}, channels{} {}
+        : in{in}, out{out}, channels{}, next{nullptr} {}
 
 uint8_t PortLink::switch_connection_selector() {
     Channel const &final = *channels.back();
@@ -109,6 +117,17 @@ IOCell *InputPort::io_connection() {
     return nullptr;
 }
 
+void InputPort::unroute() {
+    if (m_link) {
+        m_link->channels.clear();
+    }
+}
+
+void InputPort::disconnect() {
+    m_link = nullptr;
+    m_owned_link = PortLink();
+}
+
 std::ostream &operator <<(std::ostream &os, InputPort const &in) {
     if (in.m_source == InPortSource::IOCell) {
         os << "IO" << in.m_io_cell->id();
@@ -130,18 +149,30 @@ void InputPort::connect(OutputPort &out) {
 }
 
 OutputPort::OutputPort()
-        : m_cab{}, m_io_cell{}, m_source{} {}
+        : m_cab{}, m_io_cell{}, m_source{}, m_links{}, m_last_link{} {}
 
 OutputPort::OutputPort(AnalogBlock &cab, OutPortSource source)
-        : m_cab{&cab}, m_io_cell{}, m_source{source} {}
+        : m_cab{&cab}, m_io_cell{}, m_source{source}, m_links{}, m_last_link{} {}
 
 OutputPort::OutputPort(IOCell &cell)
         : m_cab{&cell.cab()}, m_io_cell{&cell}, 
-          m_source{OutPortSource::IOCell} {}
+          m_source{OutPortSource::IOCell}, m_links{}, m_last_link{} {}
 
 void OutputPort::connect(InputPort &in) {
     in.connect(*this);
-    m_links.push_back(in.link());
+    cab().chip().invalidate_routing();
+
+    if (m_last_link) {
+        m_last_link->next = in.link();
+    } else {
+        m_links = in.link();
+    }
+    m_last_link = in.link();
+}
+
+void OutputPort::disconnect() {
+    m_links = nullptr;
+    m_last_link = nullptr;
 }
 
 AnalogBlock &OutputPort::cab() {
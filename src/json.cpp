@@ -0,0 +1,389 @@
+#include "json.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+
+JsonValue::JsonValue()
+        : m_type{Type::Null}, m_bool{}, m_number{}, m_string{},
+          m_elements{}, m_members{} {}
+
+JsonValue::JsonValue(bool value)
+        : JsonValue() {
+    m_type = Type::Bool;
+    m_bool = value;
+}
+
+JsonValue::JsonValue(double value)
+        : JsonValue() {
+    m_type = Type::Number;
+    m_number = value;
+}
+
+JsonValue::JsonValue(int value)
+        : JsonValue(static_cast<double>(value)) {}
+
+JsonValue::JsonValue(std::size_t value)
+        : JsonValue(static_cast<double>(value)) {}
+
+JsonValue::JsonValue(char const *value)
+        : JsonValue(std::string(value)) {}
+
+JsonValue::JsonValue(std::string value)
+        : JsonValue() {
+    m_type = Type::String;
+    m_string = std::move(value);
+}
+
+JsonValue JsonValue::Array() {
+    JsonValue value;
+    value.m_type = Type::Array;
+    return value;
+}
+
+JsonValue JsonValue::Object() {
+    JsonValue value;
+    value.m_type = Type::Object;
+    return value;
+}
+
+bool JsonValue::as_bool() const {
+    return m_type == Type::Bool && m_bool;
+}
+
+double JsonValue::as_number() const {
+    return m_type == Type::Number ? m_number : 0.0;
+}
+
+std::string const &JsonValue::as_string() const {
+    return m_string;
+}
+
+JsonValue const &JsonValue::operator[](std::string_view key) const {
+    static JsonValue const null;
+
+    for (auto const &member : m_members) {
+        if (member.first == key) {
+            return member.second;
+        }
+    }
+    return null;
+}
+
+JsonValue &JsonValue::set(std::string key, JsonValue value) {
+    m_members.emplace_back(std::move(key), std::move(value));
+    return *this;
+}
+
+JsonValue &JsonValue::push(JsonValue value) {
+    m_elements.push_back(std::move(value));
+    return *this;
+}
+
+static void write_string(std::ostream &os, std::string const &s) {
+    static char const hex[] = "0123456789abcdef";
+
+    os << '"';
+    for (char c : s) {
+        unsigned char u = c;
+        switch (c) {
+            case '"':  os << "\\\""; break;
+            case '\\': os << "\\\\"; break;
+            case '\n': os << "\\n"; break;
+            case '\r': os << "\\r"; break;
+            case '\t': os << "\\t"; break;
+            default:
+                if (u < 0x20) {
+                    os << "\\u00" << hex[u >> 4] << hex[u & 0xF];
+                } else {
+                    os << c;
+                }
+        }
+    }
+    os << '"';
+}
+
+std::ostream &operator <<(std::ostream &os, JsonValue const &value) {
+    switch (value.m_type) {
+        case JsonValue::Type::Null:
+            return os << "null";
+
+        case JsonValue::Type::Bool:
+            return os << (value.m_bool ? "true" : "false");
+
+        case JsonValue::Type::Number: {
+            double n = value.m_number;
+            if (n == std::floor(n) && std::fabs(n) < 1e15) {
+                return os << static_cast<int64_t>(n);
+            }
+            std::stringstream ss;
+            ss.precision(17);
+            ss << n;
+            return os << ss.str();
+        }
+
+        case JsonValue::Type::String:
+            write_string(os, value.m_string);
+            return os;
+
+        case JsonValue::Type::Array:
+            os << '[';
+            for (std::size_t i = 0; i < value.m_elements.size(); i++) {
+                os << (i ? "," : "") << value.m_elements[i];
+            }
+            return os << ']';
+
+        case JsonValue::Type::Object:
+            os << '{';
+            for (std::size_t i = 0; i < value.m_members.size(); i++) {
+                os << (i ? "," : "");
+                write_string(os, value.m_members[i].first);
+                os << ':' << value.m_members[i].second;
+            }
+            return os << '}';
+    }
+    return os;
+}
+
+std::string JsonValue::dump() const {
+    std::stringstream ss;
+    ss << *this;
+    return ss.str();
+}
+
+/* Recursive descent over the text */
+class JsonParser {
+public:
+    JsonParser(std::string_view text)
+            : m_text{text}, m_pos{} {}
+
+    JsonValue parse_document() {
+        JsonValue value = parse_value();
+        skip_whitespace();
+        if (m_pos != m_text.size()) {
+            error("trailing characters");
+        }
+        return value;
+    }
+
+private:
+    JsonValue parse_value() {
+        skip_whitespace();
+        char c = peek();
+
+        if (c == '{') {
+            return parse_object();
+        } else if (c == '[') {
+            return parse_array();
+        } else if (c == '"') {
+            return JsonValue(parse_string());
+        } else if (c == '-' || (c >= '0' && c <= '9')) {
+            return parse_number();
+        } else if (consume("true")) {
+            return JsonValue(true);
+        } else if (consume("false")) {
+            return JsonValue(false);
+        } else if (consume("null")) {
+            return JsonValue();
+        }
+        error("unexpected character");
+    }
+
+    JsonValue parse_object() {
+        JsonValue object = JsonValue::Object();
+        m_pos++;
+
+        skip_whitespace();
+        if (peek() == '}') {
+            m_pos++;
+            return object;
+        }
+
+        while (true) {
+            skip_whitespace();
+            if (peek() != '"') {
+                error("expected member name");
+            }
+            std::string key = parse_string();
+
+            skip_whitespace();
+            expect(':');
+            object.set(std::move(key), parse_value());
+
+            skip_whitespace();
+            if (peek() == '}') {
+                m_pos++;
+                return object;
+            }
+            expect(',');
+        }
+    }
+
+    JsonValue parse_array() {
+        JsonValue array = JsonValue::Array();
+        m_pos++;
+
+        skip_whitespace();
+        if (peek() == ']') {
+            m_pos++;
+            return array;
+        }
+
+        while (true) {
+            array.push(parse_value());
+
+            skip_whitespace();
+            if (peek() == ']') {
+                m_pos++;
+                return array;
+            }
+            expect(',');
+        }
+    }
+
+    std::string parse_string() {
+        std::string s;
+        m_pos++;
+
+        while (true) {
+            char c = next();
+            if (c == '"') {
+                return s;
+            }
+            if (c != '\\') {
+                s += c;
+                continue;
+            }
+
+            switch (next()) {
+                case '"':  s += '"'; break;
+                case '\\': s += '\\'; break;
+                case '/':  s += '/'; break;
+                case 'b':  s += '\b'; break;
+                case 'f':  s += '\f'; break;
+                case 'n':  s += '\n'; break;
+                case 'r':  s += '\r'; break;
+                case 't':  s += '\t'; break;
+                case 'u':  append_utf8(s, parse_code_point()); break;
+                default:   error("invalid escape");
+            }
+        }
+    }
+
+    uint32_t parse_code_point() {
+        uint32_t code = parse_hex4();
+        if (code >= 0xD800 && code < 0xDC00) {
+            /* High surrogate, followed by the low one */
+            if (!consume("\\u")) {
+                error("unpaired surrogate");
+            }
+            uint32_t low = parse_hex4();
+            if (low < 0xDC00 || low >= 0xE000) {
+                error("unpaired surrogate");
+            }
+            code = 0x10000 + ((code - 0xD800) << 10) + (low - 0xDC00);
+        }
+        return code;
+    }
+
+    uint32_t parse_hex4() {
+        uint32_t code = 0;
+        for (int i = 0; i < 4; i++) {
+            char c = next();
+            code <<= 4;
+            if (c >= '0' && c <= '9') {
+                code |= c - '0';
+            } else if (c >= 'a' && c <= 'f') {
+                code |= c - 'a' + 10;
+            } else if (c >= 'A' && c <= 'F') {
+                code |= c - 'A' + 10;
+            } else {
+                error("invalid unicode escape");
+            }
+        }
+        return code;
+    }
+
+    static void append_utf8(std::string &s, uint32_t code) {
+        if (code < 0x80) {
+            s += static_cast<char>(code);
+        } else if (code < 0x800) {
+            s += static_cast<char>(0xC0 | code >> 6);
+            s += static_cast<char>(0x80 | (code & 0x3F));
+        } else if (code < 0x10000) {
+            s += static_cast<char>(0xE0 | code >> 12);
+            s += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+            s += static_cast<char>(0x80 | (code & 0x3F));
+        } else {
+            s += static_cast<char>(0xF0 | code >> 18);
+            s += static_cast<char>(0x80 | (code >> 12 & 0x3F));
+            s += static_cast<char>(0x80 | (code >> 6 & 0x3F));
+            s += static_cast<char>(0x80 | (code & 0x3F));
+        }
+    }
+
+    JsonValue parse_number() {
+        std::size_t begin = m_pos;
+        while (m_pos < m_text.size()
+               && std::string_view("+-.eE0123456789").find(m_text[m_pos])
+                  != std::string_view::npos) {
+            m_pos++;
+        }
+
+        std::string digits(m_text.substr(begin, m_pos - begin));
+        char *end = nullptr;
+        double value = std::strtod(digits.c_str(), &end);
+        if (end != digits.c_str() + digits.size()) {
+            error("invalid number");
+        }
+        return JsonValue(value);
+    }
+
+    void skip_whitespace() {
+        while (m_pos < m_text.size()
+               && (m_text[m_pos] == ' ' || m_text[m_pos] == '\t'
+                   || m_text[m_pos] == '\n' || m_text[m_pos] == '\r')) {
+            m_pos++;
+        }
+    }
+
+    char peek() const {
+        return m_pos < m_text.size() ? m_text[m_pos] : '\0';
+    }
+
+    char next() {
+        if (m_pos >= m_text.size()) {
+            error("unexpected end of text");
+        }
+        return m_text[m_pos++];
+    }
+
+    bool consume(std::string_view word) {
+        if (m_text.substr(m_pos, word.size()) != word) {
+            return false;
+        }
+        m_pos += word.size();
+        return true;
+    }
+
+    void expect(char c) {
+        if (peek() != c) {
+            error(std::string("expected '") + c + "'");
+        }
+        m_pos++;
+    }
+
+    [[noreturn]] void error(std::string const &s) const {
+        std::stringstream ss;
+        ss << "invalid JSON at " << m_pos << ": " << s;
+        throw std::runtime_error(ss.str());
+    }
+
+    std::string_view m_text;
+    std::size_t m_pos;
+};
+
+JsonValue JsonValue::Parse(std::string_view text) {
+    return JsonParser(text).parse_document();
+}
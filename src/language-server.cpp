@@ -0,0 +1,206 @@
+#include "language-server.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cstdlib>
+
+/* JSON-RPC error codes */
+static constexpr int ParseError = -32700;
+static constexpr int InvalidRequest = -32600;
+static constexpr int MethodNotFound = -32601;
+
+/* TextDocumentSyncKind.Incremental */
+static constexpr int IncrementalSync = 2;
+
+static JsonValue lsp_position(SourceText const &source, std::size_t offset,
+                              std::size_t extra_cols = 0) {
+    TextPosition position = source.position(offset);
+    return JsonValue::Object()
+        .set("line", position.line() - 1)
+        .set("character", position.col() - 1 + extra_cols);
+}
+
+static std::size_t text_offset(SourceText const &source,
+                               JsonValue const &position) {
+    std::size_t line = position["line"].as_number();
+    std::size_t character = position["character"].as_number();
+    return source.offset(line + 1, character + 1);
+}
+
+LanguageServer::LanguageServer(std::istream &in, std::ostream &out)
+        : m_in{in}, m_out{out}, m_documents{}, m_shutdown{}, m_exit{} {}
+
+int LanguageServer::run() {
+    std::string content;
+    while (!m_exit && read_message(content)) {
+        JsonValue message;
+        try {
+            message = JsonValue::Parse(content);
+        } catch (std::runtime_error const &e) {
+            reply_error(JsonValue(), ParseError, e.what());
+            continue;
+        }
+        handle(message);
+    }
+
+    return m_shutdown ? 0 : 1;
+}
+
+/* Reads the headers up to the empty line, then Content-Length bytes */
+bool LanguageServer::read_message(std::string &content) {
+    std::size_t length = 0;
+    bool has_length = false;
+
+    for (std::string line; std::getline(m_in, line); ) {
+        if (!line.empty() && line.back() == '\r') {
+            line.pop_back();
+        }
+        if (line.empty()) {
+            if (!has_length) {
+                continue;
+            }
+            content.assign(length, '\0');
+            return static_cast<bool>(m_in.read(content.data(), length));
+        }
+
+        constexpr std::string_view Header = "Content-Length:";
+        if (line.compare(0, Header.size(), Header) == 0) {
+            length = std::strtoul(line.c_str() + Header.size(), nullptr, 10);
+            has_length = true;
+        }
+    }
+    return false;
+}
+
+void LanguageServer::write_message(JsonValue const &message) {
+    std::string content = message.dump();
+    m_out << "Content-Length: " << content.size() << "\r\n\r\n" << content;
+    m_out.flush();
+}
+
+void LanguageServer::handle(JsonValue const &message) {
+    std::string const &method = message["method"].as_string();
+    JsonValue const &id = message["id"];
+    JsonValue const &params = message["params"];
+    bool is_request = !id.is_null();
+
+    if (method == "initialize") {
+        JsonValue sync = JsonValue::Object()
+            .set("openClose", true)
+            .set("change", IncrementalSync);
+        JsonValue capabilities = JsonValue::Object()
+            .set("textDocumentSync", std::move(sync));
+        JsonValue info = JsonValue::Object()
+            .set("name", "obc");
+
+        reply(id, JsonValue::Object()
+            .set("capabilities", std::move(capabilities))
+            .set("serverInfo", std::move(info)));
+    } else if (method == "shutdown") {
+        m_shutdown = true;
+        reply(id, JsonValue());
+    } else if (method == "exit") {
+        m_exit = true;
+    } else if (m_shutdown && is_request) {
+        reply_error(id, InvalidRequest, "server is shut down");
+    } else if (method == "textDocument/didOpen") {
+        open(params);
+    } else if (method == "textDocument/didChange") {
+        change(params);
+    } else if (method == "textDocument/didClose") {
+        close(params);
+    } else if (is_request) {
+        reply_error(id, MethodNotFound, "unsupported method: " + method);
+    }
+    /* Other notifications, like initialized, are ignored */
+}
+
+void LanguageServer::reply(JsonValue const &id, JsonValue result) {
+    write_message(JsonValue::Object()
+        .set("jsonrpc", "2.0")
+        .set("id", id)
+        .set("result", std::move(result)));
+}
+
+void LanguageServer::reply_error(JsonValue const &id, int code,
+                                 std::string const &s) {
+    JsonValue error = JsonValue::Object()
+        .set("code", code)
+        .set("message", s);
+
+    write_message(JsonValue::Object()
+        .set("jsonrpc", "2.0")
+        .set("id", id)
+        .set("error", std::move(error)));
+}
+
+void LanguageServer::open(JsonValue const &params) {
+    JsonValue const &item = params["textDocument"];
+    std::string const &uri = item["uri"].as_string();
+
+    auto document = std::make_unique<Document>(uri);
+    document->set_text(item["text"].as_string());
+    m_documents[uri] = std::move(document);
+
+    publish(uri);
+}
+
+void LanguageServer::change(JsonValue const &params) {
+    std::string const &uri = params["textDocument"]["uri"].as_string();
+    auto iter = m_documents.find(uri);
+    if (iter == m_documents.end()) {
+        return;
+    }
+    Document &document = *iter->second;
+
+    for (JsonValue const &change : params["contentChanges"].elements()) {
+        JsonValue const &range = change["range"];
+        if (range.is_null()) {
+            document.set_text(change["text"].as_string());
+            continue;
+        }
+
+        std::size_t begin = text_offset(document.source(), range["start"]);
+        std::size_t end = text_offset(document.source(), range["end"]);
+        document.edit(begin, end, change["text"].as_string());
+    }
+
+    publish(uri);
+}
+
+void LanguageServer::close(JsonValue const &params) {
+    std::string const &uri = params["textDocument"]["uri"].as_string();
+    m_documents.erase(uri);
+
+    /* Clears the diagnostics of the closed document */
+    write_message(JsonValue::Object()
+        .set("jsonrpc", "2.0")
+        .set("method", "textDocument/publishDiagnostics")
+        .set("params", JsonValue::Object()
+            .set("uri", uri)
+            .set("diagnostics", JsonValue::Array())));
+}
+
+void LanguageServer::publish(std::string const &uri) {
+    Document const &document = *m_documents.at(uri);
+    SourceText const &source = document.source();
+
+    JsonValue diagnostics = JsonValue::Array();
+    for (Diagnostic const &d : document.diagnostics()) {
+        JsonValue range = JsonValue::Object()
+            .set("start", lsp_position(source, d.offset))
+            .set("end", lsp_position(source, d.offset, 1));
+
+        diagnostics.push(JsonValue::Object()
+            .set("range", std::move(range))
+            .set("severity", static_cast<int>(d.severity))
+            .set("source", "obc")
+            .set("message", d.message));
+    }
+
+    write_message(JsonValue::Object()
+        .set("jsonrpc", "2.0")
+        .set("method", "textDocument/publishDiagnostics")
+        .set("params", JsonValue::Object()
+            .set("uri", uri)
+            .set("diagnostics", std::move(diagnostics))));
+}
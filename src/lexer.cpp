@@ -1,10 +1,12 @@
 #include "lexer.hpp"
-#include <fstream>
+#include "time-report.hpp"
 #include <sstream>
 #include <cctype>
 #include <stdexcept>
 #include <iostream>
 #include <unordered_map>
+#include <array>
+#include <algorithm>
 
 static bool is_whitespace(uint32_t c) {
     return std::isspace(c) || c == '\n' || c == '\r' || c == '\t';
@@ -41,47 +43,164 @@ static bool is_separator(uint32_t c) {
     return false;
 }
 
-static TokenType classify_token(std::string_view const &lexeme, 
-                                TokenType fallback) {
+/* Keywords are the token types spelled with letters. They are found by 
+   a perfect hash on length, first and last character, with a multiplier 
+   searched at compile time, so that the table follows TokenType. */
+constexpr std::size_t KeywordTableSize = 32;
+
+constexpr bool is_keyword(TokenType type) {
+    char c = to_string(type)[0];
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+constexpr std::size_t keyword_hash(std::string_view keyword, 
+                                   std::size_t multiplier) {
+    return (keyword.size() * multiplier 
+            + static_cast<unsigned char>(keyword.front()) * 3
+            + static_cast<unsigned char>(keyword.back())) 
+        % KeywordTableSize;
+}
+
+struct KeywordTable {
+    std::size_t multiplier;
+    std::array<TokenType, KeywordTableSize> slots;
+};
+
+constexpr KeywordTable build_keyword_table() {
+    for (std::size_t multiplier = 1; multiplier < 256; multiplier++) {
+        KeywordTable table = { multiplier, {} };
+        bool perfect = true;
+
+        for (std::size_t i = 0; i < NTokenTypes && perfect; i++) {
+            TokenType type = static_cast<TokenType>(i);
+            if (!is_keyword(type)) {
+                continue;
+            }
+
+            TokenType &slot = table.slots[keyword_hash(to_string(type), 
+                                                       multiplier)];
+            perfect = slot == TokenType::None;
+            slot = type;
+        }
+
+        if (perfect) {
+            return table;
+        }
+    }
+
+    return { 0, {} };
+}
+
+constexpr KeywordTable keyword_table = build_keyword_table();
+static_assert(keyword_table.multiplier != 0, 
+              "no perfect hash for the keywords, grow KeywordTableSize");
+
+/* Token types spelled with a single character, by character */
+constexpr std::array<TokenType, 256> build_char_table() {
+    std::array<TokenType, 256> table = {};
+
     for (std::size_t i = 0; i < NTokenTypes; i++) {
         TokenType type = static_cast<TokenType>(i);
-        if (to_string(type) == lexeme) {
-            return type;
-        } 
+        std::string_view spelling = to_string(type);
+        if (spelling.size() == 1 && !is_keyword(type)) {
+            table[static_cast<unsigned char>(spelling[0])] = type;
+        }
     }
-    return fallback;
+
+    return table;
 }
 
+constexpr std::array<TokenType, 256> char_table = build_char_table();
+
 static TokenType classify_keyword(std::string_view const &lexeme) {
-    return classify_token(lexeme, TokenType::Identifier);
+    TokenType type = keyword_table.slots[
+            keyword_hash(lexeme, keyword_table.multiplier)];
+
+    if (type != TokenType::None && to_string(type) == lexeme) {
+        return type;
+    }
+    return TokenType::Identifier;
 }
 
 static TokenType classify_operator(std::string_view const &lexeme) {
-    return classify_token(lexeme, TokenType::None);
+    if (lexeme.size() == 1) {
+        return char_table[static_cast<unsigned char>(lexeme[0])];
+    }
+
+    /* Few operators are longer, so they are simply compared */
+    for (std::size_t i = 0; i < NTokenTypes; i++) {
+        TokenType type = static_cast<TokenType>(i);
+        if (lexeme.size() > 1 && to_string(type) == lexeme) {
+            return type;
+        }
+    }
+    return TokenType::None;
 }
 
 static TokenType classify_separator(std::string_view const &lexeme) {
-    return classify_token(lexeme, TokenType::None);
+    return char_table[static_cast<unsigned char>(lexeme[0])];
 }
 
 Lexer::Lexer()
-        : m_text{}, m_curr{}, m_curr_pos{}, m_base{}, m_base_pos{} {}
+        : m_file{}, m_source{}, m_text{}, m_curr{}, m_base{}, m_count{} {}
+
+void Lexer::open(std::string &filename) {
+    m_file = SourceFile::Open(filename);
+    set_text(m_file.text(), filename);
+}
+
+void Lexer::open_string(std::string text, std::string const &name) {
+    m_file = SourceFile::FromString(std::move(text));
+    set_text(m_file.text(), name);
+}
+
+void Lexer::open_view(std::string_view text, std::string const &name) {
+    set_text(text, name);
+}
 
 std::vector<Token> Lexer::lex(std::string &filename) {
-    read_file(filename);
+    PhaseTimer timer(Phase::Lex);
+    open(filename);
+    return lex_text();
+}
 
+std::vector<Token> Lexer::lex_string(std::string text, 
+                                     std::string const &name) {
+    PhaseTimer timer(Phase::Lex);
+    open_string(std::move(text), name);
+    return lex_text();
+}
+
+std::vector<Token> Lexer::lex_view(std::string_view text, 
+                                   std::string const &name) {
+    PhaseTimer timer(Phase::Lex);
+    open_view(text, name);
+    return lex_text();
+}
+
+std::vector<Token> Lexer::lex_text() {
+    std::vector<Token> tokens;
+
+    do {
+        tokens.push_back(next());
+    } while (tokens.back().type() != TokenType::EndOfFile);
+
+    return tokens;
+}
+
+Token Lexer::next() {
     while (!at_eof()) {
         set_base();
         uint32_t c = get();
 
         if (std::isalpha(c) || c == '_') {
-            lex_identifier();
+            return lex_identifier();
         } else if (std::isdigit(c) || c == '.') {
-            lex_number();
+            return lex_number();
         } else if (is_operator(c)) {
-            lex_operator();
+            return lex_operator();
         } else if (is_separator(c)) {
-            lex_separator();
+            return lex_separator();
         } else if (c == '#') {
             skip_comment();
         } else if (is_whitespace(c)) {
@@ -89,26 +208,35 @@ std::vector<Token> Lexer::lex(std::string &filename) {
         } else {
             std::stringstream ss;
             ss << "unrecognized character: '" << std::string(1, c) << "'";
-            throw std::runtime_error(ss.str());
+            m_source.error(m_curr, ss.str());
         }
     }
 
-    emit(TokenType::EndOfFile);
-    return m_tokens;
-}
+    /* Counted once per pass, including the end of file, rather than 
+       per token */
+    if (m_count > 0) {
+        report_count(Counter::TokensLexed, m_count + 1);
+        m_count = 0;
+    }
 
-void Lexer::read_file(std::string &filename) {
-    std::ifstream file(filename);
+    return Token(TokenType::EndOfFile, m_base, m_curr - m_base);
+}
 
-    if (!file) {
-        throw std::runtime_error("Could not open file: " + filename);
-    }
+void Lexer::seek(std::size_t offset) {
+    m_curr = std::min(offset, m_text.size());
+    m_base = m_curr;
+}
 
-    std::stringstream buffer;
-    buffer << file.rdbuf();
+void Lexer::set_text(std::string_view text, std::string const &name) {
+    m_source.reset(text, name);
+    m_text = text;
+    m_curr = 0;
+    m_base = 0;
+    m_count = 0;
 
-    m_text = buffer.str();
-    m_curr_pos = TextPosition(filename);
+    if (m_text.size() > Token::MaxOffset) {
+        throw std::runtime_error(name + ": file too large");
+    }
 }
 
 bool Lexer::at_eof() const {
@@ -116,27 +244,23 @@ bool Lexer::at_eof() const {
 }
 
 uint32_t Lexer::get() const {
+    if (at_eof()) {
+        return '\0';
+    }
     return m_text[m_curr];
 }
 
 void Lexer::set_base() {
     m_base = m_curr;
-    m_base_pos = m_curr_pos;
 }
 
 void Lexer::forward() {
-    if (get() == '\n') {
-        m_curr_pos.next_line();
-    } else {
-        m_curr_pos.next_col();
-    }
-
     if (!at_eof()) {
         m_curr++;
     }
 }
 
-void Lexer::lex_identifier() {
+Token Lexer::lex_identifier() {
     uint32_t c = get();
 
     while (std::isalnum(c) || c == '_') {
@@ -144,10 +268,10 @@ void Lexer::lex_identifier() {
         c = get();
     }
 
-    emit(classify_keyword(lexeme()));
+    return emit(classify_keyword(lexeme()));
 }
 
-void Lexer::lex_number() {
+Token Lexer::lex_number() {
     uint32_t c = get();
 
     while (std::isdigit(c) || c == '.') {
@@ -155,10 +279,10 @@ void Lexer::lex_number() {
         c = get();
     }
 
-    emit(TokenType::Number);
+    return emit(TokenType::Number);
 }
 
-void Lexer::lex_operator() {
+Token Lexer::lex_operator() {
     uint32_t c = get();
 
     while (is_operator(c)) {
@@ -170,23 +294,23 @@ void Lexer::lex_operator() {
     if (type == TokenType::None) {
         std::stringstream ss;
         ss << "not an operator: '" << lexeme() << "'"; 
-        throw std::runtime_error(ss.str());
+        m_source.error(m_base, ss.str());
     }
 
-    emit(type);
+    return emit(type);
 }
 
-void Lexer::lex_separator() {
+Token Lexer::lex_separator() {
     forward();
 
     TokenType type = classify_separator(lexeme());
     if (type == TokenType::None) {
         std::stringstream ss;
         ss << "not a separator: '" << lexeme() << "'"; 
-        throw std::runtime_error(ss.str());
+        m_source.error(m_base, ss.str());
     }
 
-    emit(type);
+    return emit(type);
 }
 
 void Lexer::skip_comment() {
@@ -196,9 +320,15 @@ void Lexer::skip_comment() {
 }
 
 std::string_view Lexer::lexeme() const {
-    return std::string_view(m_text).substr(m_base, m_curr - m_base);
+    return m_text.substr(m_base, m_curr - m_base);
 }
 
-void Lexer::emit(TokenType type) {
-    m_tokens.emplace_back(type, lexeme(), m_base_pos);
+Token Lexer::emit(TokenType type) {
+    std::size_t length = m_curr - m_base;
+    if (length > Token::MaxLength) {
+        m_source.error(m_base, "token too long");
+    }
+
+    m_count++;
+    return Token(type, m_base, length);
 }
@@ -5,10 +5,23 @@
 #include "settings.hpp"
 #include "lexer.hpp"
 #include "parser.hpp"
+#include "server.hpp"
+#include "language-server.hpp"
+#include "obc.hpp"
+#include "batch.hpp"
+#include "thread-pool.hpp"
+#include "sweep.hpp"
+#include "explore.hpp"
+#include "time-report.hpp"
+#include "source-file.hpp"
+#include "design-cache.hpp"
 #include <iostream>
 #include <string>
 #include <fstream>
 #include <iomanip>
+#include <sstream>
+#include <array>
+#include <cstdlib>
 #include <argp.h>
 
 static argp_option options[] = {
@@ -16,6 +29,26 @@ static argp_option options[] = {
     { "raw",        'r', 0, 0,  "Write output in raw format", 0 },
     { "add-size",   's', 0, 0,  "Add size of configuration to output", 0 },
     { "add-check",  'c', 0, 0,  "Add check value at end of configuration", 0 },
+    { "combine",    'm', 0, 0,  
+      "Write all chips of a design into one bytestream", 0 },
+    { "serve",      'S', "SOCKET", 0, 
+      "Run as compile daemon listening on a Unix socket", 0 },
+    { "lsp",        'l', 0, 0,
+      "Run as language server on stdin and stdout", 0 },
+    { "batch",      'b', "LIST", 0, 
+      "Compile every '<infile> <outfile>' pair listed in LIST", 0 },
+    { "jobs",       'j', "N", 0,  "Number of worker threads for batches", 0 },
+    { "delta-from", 'd', "FILE", 0, 
+      "Only emit sections that differ from a previous output FILE", 0 },
+    { "emit-design-cache", 'e', 0, 0,
+      "Write the parsed design in binary form to OUTFILE, which can be "
+      "compiled in place of the design file", 0 },
+    { "sweep",      'w', "NAME=FIRST:LAST:STEP", 0,
+      "Compile for every value of a let constant into OUTFILE.<i>", 0 },
+    { "explore",    'x', "N", 0,
+      "Compile up to N placements of the design and write the best", 0 },
+    { "time-report", 't', "FILE", OPTION_ARG_OPTIONAL,
+      "Report time spent per compile phase, as JSON if FILE is given", 0 },
     {}
 };
 
@@ -37,18 +70,94 @@ static error_t parse_opt(int key, char *arg, argp_state *state) {
             args.add_check = true;
             break;
 
+        case 'm':
+            args.combine = true;
+            break;
+
+        case 'S':
+            args.socket = arg;
+            break;
+
+        case 'l':
+            args.lsp = true;
+            break;
+
+        case 'b':
+            args.batch = arg;
+            break;
+
+        case 'j':
+            args.n_threads = std::strtoul(arg, nullptr, 10);
+            if (args.n_threads == 0) {
+                argp_error(state, "invalid number of jobs: %s", arg);
+            }
+            break;
+
+        case 'd':
+            args.delta_from = arg;
+            break;
+
+        case 'w':
+            args.sweep = arg;
+            break;
+
+        case 'e':
+            args.emit_design_cache = true;
+            break;
+
+        case 'x':
+            args.explore = std::strtoul(arg, nullptr, 10);
+            if (args.explore == 0) {
+                argp_error(state, "--explore requires a positive number");
+            }
+            break;
+
+        case 't':
+            args.time_report = true;
+            args.time_report_file = arg ? arg : "";
+            break;
+
         case ARGP_KEY_ARG:
-            switch (state->arg_num) {
-                case 0: args.infile = arg; break;
-                case 1: args.outfile = arg; break;
-                default: argp_usage(state);
+            if (state->arg_num % 2 == 0) {
+                args.jobs.push_back({ arg, "" });
+            } else {
+                args.jobs.back().outfile = arg;
             }
             break;
 
         case ARGP_KEY_END:
-            if (args.outfile.empty()) {
+            if (!args.delta_from.empty() && args.raw) {
+                argp_error(state, "--delta-from requires bytestream output");
+            }
+            if (args.combine && args.raw) {
+                argp_error(state, "--combine requires bytestream output");
+            }
+            if (args.emit_design_cache && !args.sweep.empty()) {
+                argp_error(state, "--emit-design-cache cannot be combined "
+                           "with --sweep");
+            }
+            if (!args.sweep.empty() && args.jobs.size() != 1) {
+                argp_error(state, "--sweep requires a single design");
+            }
+            if (args.explore && (args.emit_design_cache || args.combine
+                                 || !args.sweep.empty())) {
+                argp_error(state, "--explore cannot be combined with "
+                           "--emit-design-cache, --combine or --sweep");
+            }
+            if (args.explore && args.jobs.size() != 1) {
+                argp_error(state, "--explore requires a single design");
+            }
+            if (!args.socket.empty() || !args.batch.empty() || args.lsp) {
+                if (!args.jobs.empty()) {
+                    argp_usage(state);
+                }
+                break;
+            }
+            if (args.jobs.empty() || args.jobs.back().outfile.empty()) {
                 argp_usage(state);
             }
+            args.infile = args.jobs.front().infile;
+            args.outfile = args.jobs.front().outfile;
             // end conditions
             break;
 
@@ -62,11 +171,78 @@ static struct argp argp = {
     options, parse_opt, nullptr, nullptr, nullptr, nullptr, nullptr 
 };
 
+/* Reads a previous output of the compiler: either a raw image or a 
+   bytestream, possibly with size and check values. */
+ShadowSRam read_image(std::string const &filename) {
+    std::ifstream f(filename);
+    if (!f) {
+        throw std::runtime_error("Could not open file: " + filename);
+    }
+
+    std::vector<int> values;
+    for (int value; f >> value; ) {
+        values.push_back(value);
+    }
+
+    ShadowSRam ssram;
+    constexpr std::size_t HeaderSize = 7;
+    constexpr int Synch = 0xD5;
+
+    if (values.size() == ssram.size() && values.front() != Synch) {
+        for (std::size_t i = 0; i < values.size(); i++) {
+            ssram.set(i / 0x20, i % 0x20, static_cast<uint8_t>(values[i]));
+        }
+        return ssram;
+    }
+
+    std::size_t begin = 0, end = values.size();
+    if (end > 0 && values.front() != Synch) {
+        begin++; /* --add-size */
+    }
+    if (end > begin && values.back() == 1337) {
+        end--; /* --add-check */
+    }
+
+    if (end - begin < HeaderSize || values[begin] != Synch) {
+        throw std::runtime_error(filename + ": not a configuration");
+    }
+
+    std::vector<uint8_t> data(values.begin() + begin + HeaderSize, 
+                              values.begin() + end);
+    ssram.apply_data_bytestream(data.data(), data.size());
+
+    return ssram;
+}
+
+void write_data(std::ostream &f, std::vector<uint8_t> const &data) {
+#if 0    
+    f << std::hex << std::setfill('0') << std::uppercase;
+
+    f << "const unsigned char an_FPAA1_PrimaryConfigInfo[] = {\n";
+    for (uint8_t byte : data) {
+        f << "  0x" << static_cast<int>(byte) << ",\n";
+    }
+    f << "};\n";
+#else
+    if (args.add_size) {
+        f << data.size() << std::endl;
+    }
+    for (uint8_t byte : data) {
+        f << static_cast<int>(byte) << std::endl;
+    }
+    if (args.add_check) {
+        f << 1337 << std::endl;
+    }
+#endif
+}
+
 /* Will be expanded, for now just a function */
-void write(AnalogChip &chip) {
-    std::ofstream f(args.outfile);
+void write(AnalogChip &chip, CompileResult const &result, 
+           std::string const &outfile) {
+    PhaseTimer timer(Phase::WriteOutput);
+    std::ofstream f(outfile);
 
-    ShadowSRam ssram = chip.compile();
+    ShadowSRam const &ssram = result.ssram;
 
     if (args.verbose) {
         std::cerr << ssram << std::endl;
@@ -87,37 +263,69 @@ void write(AnalogChip &chip) {
             std::cerr << "Writing C configuration..." << std::endl;
         }
 
-        std::vector<uint8_t> data;
-        chip.to_header_bytestream(data);
-        ssram.to_data_bytestream(data);
+        std::vector<uint8_t> data = result.bytestream;
+
+        if (!args.delta_from.empty()) {
+            ShadowSRam previous = read_image(args.delta_from);
+            data = delta_bytestream(chip, previous, ssram);
+
+            std::size_t full = result.bytestream.size();
+            std::cerr << outfile << ": " << data.size() << " of " << full
+                      << " bytes, saved " << full - data.size() 
+                      << " bytes" << std::endl;
+        }
     
         if (args.verbose) {
             std::cerr << "Bytestream length: " << data.size() << std::endl;
         }
-#if 0    
-        f << std::hex << std::setfill('0') << std::uppercase;
-    
-        f << "const unsigned char an_FPAA1_PrimaryConfigInfo[] = {\n";
-        for (uint8_t byte : data) {
-            f << "  0x" << static_cast<int>(byte) << ",\n";
-        }
-        f << "};\n";
-#else
-        if (args.add_size) {
-            f << data.size() << std::endl;
-        }
-        for (uint8_t byte : data) {
-            f << static_cast<int>(byte) << std::endl;
-        }
-        if (args.add_check) {
-            f << 1337 << std::endl;
-        }
-#endif
+        write_data(f, data);
     }
 
     f.close();
 }
 
+CompileOptions compile_options() {
+    CompileOptions options;
+    options.log = args.verbose ? &std::cerr : nullptr;
+    return options;
+}
+
+void write(AnalogChip &chip, std::string const &outfile) {
+    write(chip, compile_chip(chip, compile_options()), outfile);
+}
+
+/* Writes the configurations of several chips one after another, each 
+   with the header for its device address */
+void write_combined(std::vector<std::unique_ptr<AnalogChip>> const &chips,
+                    std::vector<CompileResult> const &results,
+                    std::string const &outfile) {
+    PhaseTimer timer(Phase::WriteOutput);
+
+    std::vector<uint8_t> data;
+    std::array<bool, 0x100> used = {};
+
+    for (std::size_t i = 0; i < chips.size(); i++) {
+        uint8_t address = chips[i]->address();
+        if (used[address]) {
+            std::stringstream ss;
+            ss << outfile << ": several chips have address " 
+               << static_cast<int>(address);
+            throw std::runtime_error(ss.str());
+        }
+        used[address] = true;
+
+        std::vector<uint8_t> const &bytestream = results[i].bytestream;
+        data.insert(data.end(), bytestream.begin(), bytestream.end());
+    }
+
+    if (args.verbose) {
+        std::cerr << "Bytestream length: " << data.size() << std::endl;
+    }
+
+    std::ofstream f(outfile);
+    write_data(f, data);
+}
+
 void load_doubling_sum(AnalogChip &chip) {
     chip.io_cell(1).set_mode(IOMode::InputBypass);
 
@@ -228,21 +436,263 @@ void load(AnalogChip &chip) {
     chip.io_cell(3).out(1).connect(integ.comp().in());
 }
 
-std::unique_ptr<AnalogChip> parse_file(std::string filename) {
+/* Elaborates a design file or loads a design cache */
+std::vector<std::unique_ptr<AnalogChip>> parse_file(std::string filename) {
+    SourceFile file = SourceFile::Open(filename);
+    if (is_design_cache(file.text())) {
+        return load_design_cache(file.text(), filename);
+    }
+
+    Lexer lexer;
+    lexer.open_view(file.text(), filename);
+
+    Parser parser;
+    return parser.parse_chips(lexer);
+}
+
+void emit_design_cache(std::string const &infile, 
+                       std::string const &outfile) {
+    SourceFile file = SourceFile::Open(infile);
     Lexer lexer;
-    std::vector<Token> tokens = lexer.lex(filename);
+    lexer.open_view(file.text(), infile);
 
+    DesignCacheWriter cache;
     Parser parser;
-    std::unique_ptr<AnalogChip> chip = parser.parse(tokens);
+    parser.set_cache(&cache);
+    parser.parse_chips(lexer);
+
+    std::vector<uint8_t> blob = cache.finish();
 
-    return chip;
+    PhaseTimer timer(Phase::WriteOutput);
+    std::ofstream f(outfile, std::ios::binary);
+    f.write(reinterpret_cast<char const *>(blob.data()), blob.size());
+    if (!f) {
+        throw std::runtime_error("Could not write file: " + outfile);
+    }
 }
 
-int main(int argc, char *argv[]) {
-    argp_parse(&argp, argc, argv, 0, 0, nullptr);
+/* Compiles every chip of a design on up to n_threads threads. A single 
+   chip is written to outfile, several chips to OUTFILE.<i> or, with 
+   --combine, into one stream in outfile. */
+void compile_file(std::string const &infile, std::string const &outfile,
+                  std::size_t n_threads) {
+    if (args.emit_design_cache) {
+        emit_design_cache(infile, outfile);
+        return;
+    }
+
+    auto chips = parse_file(infile);
+
+    if (chips.size() == 1 && !args.combine) {
+        write(*chips[0], outfile);
+        return;
+    }
+
+    if (!args.delta_from.empty()) {
+        throw std::runtime_error(infile + ": --delta-from requires a design " 
+                                 "with a single chip");
+    }
+
+    auto results = compile_chips(chips, compile_options(), n_threads);
+
+    if (args.combine) {
+        write_combined(chips, results, outfile);
+        return;
+    }
+
+    for (std::size_t i = 0; i < chips.size(); i++) {
+        write(*chips[i], results[i], outfile + "." + std::to_string(i));
+    }
+}
+
+/* Compiles the jobs of a batch, reporting failures and throughput on
+   stderr. Returns the number of failed jobs. */
+std::size_t batch(std::size_t n_threads) {
+    TimeReport *report = TimeReport::current();
+    BatchResult result = run_batch(args.jobs, n_threads, 
+                                   [report](BatchJob const &job) {
+        ScopedTimeReport scope(report);
+        compile_file(job.infile, job.outfile, 1);
+    });
+
+    for (std::size_t i = 0; i < args.jobs.size(); i++) {
+        if (!result.errors[i].empty()) {
+            std::cerr << args.jobs[i].infile << ": " << result.errors[i] 
+                      << std::endl;
+        }
+    }
+
+    std::cerr << args.jobs.size() << " designs (" << result.n_failed 
+              << " failed) in " << result.seconds << " s on " << n_threads 
+              << " threads: " << args.jobs.size() / result.seconds 
+              << " designs/s" << std::endl;
+
+    return result.n_failed;
+}
+
+std::size_t sweep(std::string const &infile, std::string const &outfile,
+                  std::size_t n_threads) {
+    SweepRange range = parse_sweep_range(args.sweep);
+
+    SourceFile source = SourceFile::Open(infile);
+    if (is_design_cache(source.text())) {
+        throw std::runtime_error(infile + ": cannot sweep a design cache, "
+                                 "which has no let constants");
+    }
+
+    CompileOptions options = compile_options();
+    options.name = infile;
+
+    SweepResult swept = run_sweep(source.text(), options, range, n_threads,
+            [&](std::size_t i, AnalogChip &chip, 
+                CompileResult const &result) {
+        write(chip, result, outfile + "." + std::to_string(i));
+    });
+
+    for (std::size_t i = 0; i < range.size(); i++) {
+        if (!swept.errors[i].empty()) {
+            std::cerr << range.constant << " = " << range.value(i) << ": " 
+                      << swept.errors[i] << std::endl;
+        }
+    }
+
+    std::cerr << range.size() << " points (" << swept.n_failed 
+              << " failed) in " << swept.seconds << " s on " << n_threads 
+              << " threads: " << range.size() / swept.seconds 
+              << " points/s" << std::endl;
+
+    std::ofstream index(outfile + ".index");
+    index << std::setprecision(15);
+    for (std::size_t i = 0; i < range.size(); i++) {
+        index << i << " " << range.constant << "=" << range.value(i) << " " 
+              << outfile << "." << i << std::endl;
+    }
+
+    return swept.n_failed;
+}
+
+static void print_variant(std::ostream &os, ChipVariant const &variant) {
+    char const *sep = "";
+    for (int i = 1; i <= NBlocksPerChip; i++) {
+        if (variant.cabs[i] != i) {
+            os << sep << "CAB" << i << " -> CAB" << variant.cabs[i];
+            sep = ", ";
+        }
+    }
+    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+        if (variant.io_cells[i] != i) {
+            os << sep << "io" << i << " -> io" << variant.io_cells[i];
+            sep = ", ";
+        }
+    }
+    for (int i = 1; i <= NBlocksPerChip; i++) {
+        if (variant.reversed_opamps[i]) {
+            os << sep << "CAB" << i << " op-amps swapped";
+            sep = ", ";
+        }
+    }
+    if (!*sep) {
+        os << "as designed";
+    }
+}
+
+static std::ostream &operator<<(std::ostream &os, VariantCost const &cost) {
+    return os << cost.n_channels << " channels, " << cost.n_bytes
+              << " bytes, " << cost.n_clocks << " clocks";
+}
+
+/* Writes the best variant of the design, reporting the exploration, the
+   best variant and the design itself on stderr */
+void explore(std::string const &infile, std::string const &outfile,
+             std::size_t n_threads) {
+    SourceFile source = SourceFile::Open(infile);
+
+    CompileOptions options = compile_options();
+    options.name = infile;
+
+    ExploreResult explored = run_explore(source.text(), options, 
+                                         args.explore, n_threads);
+    write(*explored.chip, explored.result, outfile);
+
+    std::cerr << explored.n_variants << " of " << explored.n_possible 
+              << " variants (" << explored.n_failed << " failed, " 
+              << explored.n_pruned << " pruned) in " << explored.seconds 
+              << " s on " << n_threads << " threads" << std::endl;
+
+    std::cerr << "best: variant " << explored.index << " (";
+    print_variant(std::cerr, explored.variant);
+    std::cerr << "): " << explored.cost << std::endl;
+
+    std::cerr << "design: ";
+    if (explored.design_error.empty()) {
+        std::cerr << explored.design_cost << std::endl;
+    } else {
+        std::cerr << explored.design_error << std::endl;
+    }
+}
+
+void write_time_report(TimeReport const &report) {
+    if (args.time_report_file.empty()) {
+        std::cerr << report;
+        return;
+    }
+
+    std::ofstream f(args.time_report_file);
+    if (!f) {
+        throw std::runtime_error("Could not open file: " 
+                                 + args.time_report_file);
+    }
+    report.write_json(f);
+}
+
+int run() {
+    if (args.lsp) {
+        LanguageServer server(std::cin, std::cout);
+        return server.run();
+    }
+
+    if (!args.socket.empty()) {
+        Server server(args.socket, args.verbose);
+        server.run();
+        return 0;
+    }
+
+    if (!args.batch.empty()) {
+        args.jobs = read_batch_list(args.batch);
+    }
+
+    std::size_t n_threads = args.n_threads ? args.n_threads 
+                                           : default_n_threads();
 
-    auto chip = parse_file(args.infile);
-    write(*chip);
+    if (!args.sweep.empty()) {
+        return sweep(args.infile, args.outfile, n_threads) ? 1 : 0;
+    }
+
+    if (args.explore) {
+        explore(args.infile, args.outfile, n_threads);
+        return 0;
+    }
+
+    if (args.jobs.size() > 1 || !args.batch.empty()) {
+        return batch(n_threads) ? 1 : 0;
+    }
+
+    compile_file(args.infile, args.outfile, n_threads);
     
     return 0;
 }
+
+int main(int argc, char *argv[]) {
+    argp_parse(&argp, argc, argv, 0, 0, nullptr);
+
+    TimeReport report;
+    ScopedTimeReport scope(args.time_report ? &report : nullptr);
+
+    int status = run();
+
+    if (args.time_report) {
+        write_time_report(report);
+    }
+
+    return status;
+}
@@ -0,0 +1,97 @@
+#include "matching.hpp"
+#include <limits>
+
+static constexpr int Unreached = std::numeric_limits<int>::max();
+
+BipartiteMatching::BipartiteMatching(std::size_t n_left, std::size_t n_right)
+        : m_edges(n_left), m_left(n_left, Free), m_right(n_right, Free),
+          m_depth(n_left, Unreached) {}
+
+void BipartiteMatching::add_edge(std::size_t left, std::size_t right) {
+    m_edges[left].push_back(right);
+}
+
+std::size_t BipartiteMatching::solve() {
+    std::size_t size = 0;
+    while (layer()) {
+        for (std::size_t u = 0; u < m_edges.size(); u++) {
+            if (m_left[u] == Free && augment(u)) {
+                size++;
+            }
+        }
+    }
+    return size;
+}
+
+/* Sets the depth of every left vertex on a shortest alternating path
+   from a free one, and returns whether any such path ends in a free right
+   vertex */
+bool BipartiteMatching::layer() {
+    std::vector<std::size_t> queue;
+    for (std::size_t u = 0; u < m_edges.size(); u++) {
+        if (m_left[u] == Free) {
+            m_depth[u] = 0;
+            queue.push_back(u);
+        } else {
+            m_depth[u] = Unreached;
+        }
+    }
+
+    bool found = false;
+    for (std::size_t head = 0; head < queue.size(); head++) {
+        std::size_t u = queue[head];
+        for (std::size_t v : m_edges[u]) {
+            int w = m_right[v];
+            if (w == Free) {
+                found = true;
+            } else if (m_depth[w] == Unreached) {
+                m_depth[w] = m_depth[u] + 1;
+                queue.push_back(w);
+            }
+        }
+    }
+    return found;
+}
+
+/* Follows the layers from left vertex u to a free right vertex and flips
+   the path. Vertices that lead nowhere are taken out of the layers. */
+bool BipartiteMatching::augment(std::size_t u) {
+    for (std::size_t v : m_edges[u]) {
+        int w = m_right[v];
+        if (w == Free || (m_depth[w] == m_depth[u] + 1 && augment(w))) {
+            m_left[u] = v;
+            m_right[v] = u;
+            return true;
+        }
+    }
+
+    m_depth[u] = Unreached;
+    return false;
+}
+
+void BipartiteMatching::deficient_set(std::size_t left,
+                                      std::vector<bool> &lefts,
+                                      std::vector<bool> &rights) const {
+    lefts.assign(m_edges.size(), false);
+    rights.assign(m_right.size(), false);
+
+    std::vector<std::size_t> stack = { left };
+    lefts[left] = true;
+    while (!stack.empty()) {
+        std::size_t u = stack.back();
+        stack.pop_back();
+
+        for (std::size_t v : m_edges[u]) {
+            if (rights[v]) {
+                continue;
+            }
+            rights[v] = true;
+
+            int w = m_right[v];
+            if (w != Free && !lefts[w]) {
+                lefts[w] = true;
+                stack.push_back(w);
+            }
+        }
+    }
+}
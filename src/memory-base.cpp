@@ -1,5 +1,6 @@
 #include "memory-base.hpp"
 #include "error.hpp"
+#include "time-report.hpp"
 #include <iomanip>
 #include <sstream>
 
@@ -50,7 +51,6 @@ void MemoryBase::set(std::size_t bank_addr, std::size_t byte_addr,
         throw DesignError(ss.str());
     }
     if (get(bank_addr, byte_addr).is_set()) {
-        std::cerr << *this << std::endl;
         std::stringstream ss;
         ss << "Memory at " << std::hex << bank_addr << ":" 
            << byte_addr << std::dec << " already written";
@@ -70,36 +70,57 @@ void MemoryBase::set(std::size_t bank_addr, std::size_t byte_addr,
     }
 }
 
-void MemoryBase::to_data_bytestream(std::vector<uint8_t> &data) const {
+void MemoryBase::clear() {
+    for (std::size_t i = 0; i < size(); i++) {
+        m_banks[i] = MemoryCell();
+    }
+}
+
+void MemoryBase::clear_bank(std::size_t bank_addr) {
+    if (!includes(bank_addr, 0)) {
+        std::stringstream ss;
+        ss << "illegal access to bank " << std::hex << bank_addr << std::endl;
+        throw DesignError(ss.str());
+    }
+
+    std::size_t start = translate(bank_addr, 0);
+    for (std::size_t i = start; i < start + m_bank_size; i++) {
+        m_banks[i] = MemoryCell();
+    }
+}
+
+template <typename Differs>
+void MemoryBase::emit_sections(Differs differs, 
+                               std::vector<uint8_t> &data) const {
     constexpr int SectionHeaderSize = 4;
 
     std::vector<std::vector<uint8_t>> sections;
     std::vector<uint8_t> section, data_section;
 
     for (std::size_t i = 0; i < size(); /* manual increment */) {
-        if (m_banks[i].value() == 0) {
+        if (!differs(i)) {
             i++;
             continue;
         }
     
         section.clear();
     
-        std::size_t null_count = 0;
+        std::size_t same_count = 0;
         std::size_t start = i;
         std::size_t j = i;
     
-        for (; j < size() && null_count <= SectionHeaderSize && j - start <= 256; j++) {
-            if (m_banks[j].value() == 0) {
-                null_count++;
+        for (; j < size() && same_count <= SectionHeaderSize && j - start <= 256; j++) {
+            if (!differs(j)) {
+                same_count++;
             } else {
-                null_count = 0;
+                same_count = 0;
             }
     
             section.push_back(m_banks[j].value());
         }
     
-        // Trim trailing zeros
-        while (!section.empty() && section.back() == 0) {
+        // Trim trailing bytes that need no update
+        while (!section.empty() && !differs(start + section.size() - 1)) {
             section.pop_back();
         }
     
@@ -123,6 +144,8 @@ void MemoryBase::to_data_bytestream(std::vector<uint8_t> &data) const {
         i = j;
     }
     
+    report_count(Counter::SectionsEmitted, sections.size());
+
     for (std::size_t i = 0; i < sections.size(); i++) {
         bool last = i == sections.size() - 1;
         section = sections[i];
@@ -139,6 +162,70 @@ void MemoryBase::to_data_bytestream(std::vector<uint8_t> &data) const {
     }
 }
 
+void MemoryBase::to_data_bytestream(std::vector<uint8_t> &data) const {
+    PhaseTimer timer(Phase::ToDataBytestream);
+
+    /* The configuration SRAM is cleared before a primary configuration */
+    emit_sections([this](std::size_t i) { 
+        return m_banks[i].value() != 0; 
+    }, data);
+}
+
+void MemoryBase::to_delta_bytestream(MemoryBase const &previous, 
+                                     std::vector<uint8_t> &data) const {
+    if (previous.size() != size() 
+            || previous.m_bank_addr_start != m_bank_addr_start) {
+        throw DesignError("cannot compare memories of different layout");
+    }
+
+    PhaseTimer timer(Phase::ToDataBytestream);
+
+    emit_sections([this, &previous](std::size_t i) {
+        return m_banks[i].value() != previous.m_banks[i].value(); 
+    }, data);
+}
+
+std::size_t MemoryBase::apply_data_bytestream(uint8_t const *data, 
+                                              std::size_t size) {
+    std::size_t i = 0;
+
+    /* A delta without changes carries no sections at all */
+    if (size == 0) {
+        return 0;
+    }
+
+    while (true) {
+        if (i + 3 > size) {
+            throw DesignError("truncated section header in bytestream");
+        }
+
+        uint8_t flags = data[i] & 0b1100'0000;
+        std::size_t byte_addr = (data[i] & 0b0011'1111) - m_bank_addr_start;
+        std::size_t bank_addr = data[i + 1];
+        std::size_t length = data[i + 2] == 0 ? 256 : data[i + 2];
+        i += 3;
+
+        std::size_t start = bank_addr * m_bank_size + byte_addr;
+        if (i + length + 1 > size || start + length > this->size()) {
+            throw DesignError("section exceeds bytestream or memory");
+        }
+
+        for (std::size_t j = 0; j < length; j++) {
+            m_banks[start + j] = MemoryCell(data[i + j]);
+        }
+        i += length;
+
+        if (data[i] != 0x2A) {
+            throw DesignError("missing section terminator in bytestream");
+        }
+        i++;
+
+        if (flags != 0b1100'0000) {
+            return i;
+        }
+    }
+}
+
 std::size_t MemoryBase::translate(std::size_t bank_addr, 
                                   std::size_t byte_addr) const {
     return (bank_addr - m_bank_addr_start) * m_bank_size + byte_addr;
@@ -0,0 +1,99 @@
+#include "obc.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "design-cache.hpp"
+#include "thread-pool.hpp"
+#include "time-report.hpp"
+
+static void release_chips(std::vector<std::unique_ptr<AnalogChip>> &chips,
+                          ChipPool *pool) {
+    if (pool) {
+        for (auto &chip : chips) {
+            pool->release(std::move(chip));
+        }
+    }
+}
+
+static CompileResult compile_design(std::string_view source,
+                                    CompileOptions const &options, 
+                                    Parser &parser, ChipPool *pool) {
+    std::vector<std::unique_ptr<AnalogChip>> chips;
+    if (is_design_cache(source)) {
+        chips = load_design_cache(source, options.name, pool);
+    } else {
+        Lexer lexer;
+        lexer.open_view(source, options.name);
+        chips = parser.parse_chips(lexer);
+    }
+
+    /* Only the first chip is compiled, but all of them go back to the 
+       pool, also if the design fails to compile */
+    CompileResult result;
+    try {
+        result = compile_chip(*chips[0], options);
+    } catch (...) {
+        release_chips(chips, pool);
+        throw;
+    }
+
+    release_chips(chips, pool);
+    return result;
+}
+
+CompileResult compile_design(std::string_view source,
+                             CompileOptions const &options) {
+    Parser parser;
+    return compile_design(source, options, parser, nullptr);
+}
+
+CompileResult compile_design(std::string_view source,
+                             CompileOptions const &options, 
+                             ChipPool &pool) {
+    Parser parser(pool);
+    return compile_design(source, options, parser, &pool);
+}
+
+CompileResult compile_chip(AnalogChip &chip, CompileOptions const &options) {
+    CompileResult result;
+
+    result.ssram = chip.compile(options);
+
+    chip.to_header_bytestream(result.bytestream);
+    result.ssram.to_data_bytestream(result.bytestream);
+
+    return result;
+}
+
+std::vector<CompileResult> compile_chips(
+        std::vector<std::unique_ptr<AnalogChip>> const &chips,
+        CompileOptions const &options, std::size_t n_threads) {
+    std::vector<CompileResult> results(chips.size());
+    TimeReport *report = TimeReport::current();
+
+    parallel_for(chips.size(), n_threads, [&](std::size_t i, std::size_t) {
+        ScopedTimeReport scope(report);
+        results[i] = compile_chip(*chips[i], options);
+    });
+
+    return results;
+}
+
+std::vector<uint8_t> delta_bytestream(AnalogChip const &chip,
+                                      ShadowSRam const &previous,
+                                      ShadowSRam const &current) {
+    std::vector<uint8_t> data;
+
+    chip.to_header_bytestream(data, ConfigurationType::Update);
+    current.to_delta_bytestream(previous, data);
+
+    return data;
+}
+
+void recompile_chip(AnalogChip &chip, CompileResult &result,
+                    CompileOptions const &options) {
+    chip.recompile(result.ssram, options);
+
+    result.bytestream.clear();
+    chip.to_header_bytestream(result.bytestream);
+    result.ssram.to_data_bytestream(result.bytestream);
+}
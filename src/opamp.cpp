@@ -29,6 +29,12 @@ OpAmp &OpAmp::claim(AnalogModule &module) {
     return set_feedback({ 0x00, 0x05 });
 }
 
+void OpAmp::release() {
+    m_module = nullptr;
+    m_switch_cfg = {};
+    m_out.disconnect();
+}
+
 OpAmp &OpAmp::set_feedback(SwitchConfiguration switch_cfg) {
     m_switch_cfg[0] = switch_cfg.b1;
     m_switch_cfg[1] = switch_cfg.b2;
@@ -1,14 +1,28 @@
 #include "parser.hpp"
+#include "placer.hpp"
+#include "time-report.hpp"
 #include <sstream>
 #include <stdexcept>
 #include <cmath>
 
 Parser::Parser()
-        : m_tokens{}, m_curr{}, m_opened{},
-          m_chip_cams{}, m_named_consts{} {}
+        : m_pool{}, m_cache{}, m_lexer{}, m_token{}, m_opened{},
+          m_chip_cams{}, m_unplaced{}, m_links{}, m_named_consts{}, 
+          m_deps{}, m_bindings{}, m_structural_consts{} {}
 
-std::unique_ptr<AnalogChip> Parser::parse(std::vector<Token> tokens) {
-    m_tokens = tokens;
+Parser::Parser(ChipPool &pool)
+        : m_pool{&pool}, m_cache{}, m_lexer{}, m_token{}, m_opened{},
+          m_chip_cams{}, m_unplaced{}, m_links{}, m_named_consts{}, 
+          m_deps{}, m_bindings{}, m_structural_consts{} {}
+
+std::unique_ptr<AnalogChip> Parser::parse(Lexer &lexer) {
+    return std::move(parse_chips(lexer)[0]);
+}
+
+std::vector<std::unique_ptr<AnalogChip>> Parser::parse_chips(Lexer &lexer) {
+    PhaseTimer timer(Phase::Parse);
+    m_lexer = &lexer;
+    m_token = m_lexer->next();
 
     std::vector<std::unique_ptr<AnalogChip>> chips;
 
@@ -16,7 +30,7 @@ std::unique_ptr<AnalogChip> Parser::parse(std::vector<Token> tokens) {
         if (matches(TokenType::Let)) {
             parse_let_declaration();
         } else if (matches(TokenType::Chip)) {
-            auto chip = parse_chip();
+            auto chip = parse_chip(chips.size());
             chips.push_back(std::move(chip));
         } else {
             expect_error("declaration");
@@ -26,27 +40,132 @@ std::unique_ptr<AnalogChip> Parser::parse(std::vector<Token> tokens) {
     if (chips.size() < 1) {
         throw std::runtime_error("expected at least one chip");
     }
-    return std::move(chips[0]);
+    return chips;
+}
+
+std::unique_ptr<AnalogChip> Parser::parse_declaration(Lexer &lexer,
+                                                      std::size_t offset,
+                                                      std::size_t index) {
+    m_lexer = &lexer;
+    m_lexer->seek(offset);
+    m_token = m_lexer->next();
+
+    if (matches(TokenType::Let)) {
+        parse_let_declaration();
+        return nullptr;
+    } else if (matches(TokenType::Chip)) {
+        return parse_chip(index);
+    }
+    expect_error("declaration");
+}
+
+void Parser::define(std::string_view name, double value) {
+    m_named_consts[name] = value;
+}
+
+double const *Parser::find_constant(std::string_view name) const {
+    auto iter = m_named_consts.find(name);
+    return iter != m_named_consts.end() ? &iter->second : nullptr;
+}
+
+void Parser::check_sweepable(std::string_view constant) const {
+    if (m_named_consts.find(constant) == m_named_consts.end()) {
+        std::stringstream ss;
+        ss << "'" << constant << "' is not a defined constant";
+        throw std::runtime_error(ss.str());
+    }
+
+    for (std::string_view name : dependents(constant)) {
+        if (m_structural_consts.count(name)) {
+            std::stringstream ss;
+            ss << "cannot sweep '" << constant << "': '" << name 
+               << "' determines the chip structure";
+            throw std::runtime_error(ss.str());
+        }
+    }
+}
+
+void Parser::rebind(std::string_view constant, double value) {
+    auto iter = m_named_consts.find(constant);
+    if (iter == m_named_consts.end()) {
+        std::stringstream ss;
+        ss << "'" << constant << "' is not a defined constant";
+        throw std::runtime_error(ss.str());
+    }
+    iter->second = value;
+
+    std::unordered_set<std::string_view> changed = { iter->first };
+
+    /* Bindings are in source order, so constants are updated before any 
+       expression using them is re-evaluated */
+    for (Binding const &binding : m_bindings) {
+        bool depends = false;
+        for (std::string_view dep : binding.deps) {
+            depends = depends || changed.count(dep);
+        }
+        if (!depends || (!binding.cam && binding.name == constant)) {
+            continue;
+        }
+
+        m_lexer->seek(binding.begin);
+        m_token = m_lexer->next();
+        double updated = parse_double_expression();
+
+        /* The dependencies of the binding are known already */
+        m_deps.clear();
+
+        if (binding.cam) {
+            binding.cam->update_parameter(binding.param, updated);
+        } else {
+            m_named_consts[binding.name] = updated;
+            changed.insert(binding.name);
+        }
+    }
+}
+
+void Parser::bind(std::string_view name, AnalogModule *cam, int param,
+                  std::size_t begin) {
+    if (!m_deps.empty()) {
+        m_bindings.push_back({ name, cam, param, begin, std::move(m_deps) });
+    }
+    m_deps.clear();
+}
+
+std::unordered_set<std::string_view> Parser::dependents(
+        std::string_view constant) const {
+    std::unordered_set<std::string_view> result = { constant };
+
+    for (Binding const &binding : m_bindings) {
+        if (binding.cam) {
+            continue;
+        }
+        for (std::string_view dep : binding.deps) {
+            if (result.count(dep)) {
+                result.insert(binding.name);
+            }
+        }
+    }
+
+    return result;
 }
 
 void Parser::expect_error(std::string const &expected) {
-    Token &token = m_tokens[m_curr];
     std::stringstream ss;
-    ss << "expected " << expected << ", but got " << token.type();
-    token.error(ss.str());
+    ss << "expected " << expected << ", but got " << m_token.type();
+    error(m_token, ss.str());
 }
 
-void Parser::check_shadowed_definition(Token &name) {
-    if (m_chip_cams.find(name.lexeme()) != m_chip_cams.end()
-        || m_named_consts.find(name.lexeme()) != m_named_consts.end()) {
+void Parser::check_shadowed_definition(Token const &name) {
+    if (m_chip_cams.find(lexeme(name)) != m_chip_cams.end()
+        || m_named_consts.find(lexeme(name)) != m_named_consts.end()) {
         std::stringstream ss;
-        ss << "declaration of '" << name.lexeme() 
+        ss << "declaration of '" << lexeme(name) 
            << "' shadows previous definition";
-        name.error(ss.str());
+        error(name, ss.str());
     }
 }
 
-AnalogModule *Parser::find_cam(AnalogChip &chip, Token &name) {
+AnalogModule *Parser::find_cam(AnalogChip &chip, Token const &name) {
     static const std::unordered_map<std::string_view, int> io_map {
         { "io1", 1 },
         { "io2", 2 },
@@ -54,40 +173,39 @@ AnalogModule *Parser::find_cam(AnalogChip &chip, Token &name) {
         { "io4", 4 },
     };
 
-    std::string_view const &lexeme = name.lexeme();
+    std::string_view key = lexeme(name);
 
-    auto io_iter = io_map.find(lexeme);
+    auto io_iter = io_map.find(key);
     if (io_iter != io_map.end()) {
         return &chip.io_cell(io_iter->second);
     }
 
-    auto cam_iter = m_chip_cams.find(lexeme);
+    auto cam_iter = m_chip_cams.find(key);
     if (cam_iter != m_chip_cams.end()) {
         return cam_iter->second;
     }
 
     std::stringstream ss;
-    ss << lexeme << " is not a CAM";
-    name.error(ss.str());
+    ss << key << " is not a CAM";
+    error(name, ss.str());
 }
 
 bool Parser::at_eof() const {
-    return m_tokens[m_curr].type() == TokenType::EndOfFile;
+    return m_token.type() == TokenType::EndOfFile;
 }
 
-Token &Parser::accept(TokenType type) {
-    Token &token = m_tokens[m_curr];
+Token Parser::accept(TokenType type) {
+    Token token = m_token;
     if (token.type() == type) {
         forward();
         return token;
     }
 
-    static Token none;
-    return none;
+    return Token();
 }
 
-Token &Parser::expect(TokenType type) {
-    Token &token = m_tokens[m_curr];
+Token Parser::expect(TokenType type) {
+    Token token = m_token;
     if (token.type() == type) {
         forward();
         return token;
@@ -97,12 +215,12 @@ Token &Parser::expect(TokenType type) {
 }
 
 bool Parser::matches(TokenType type) {
-    return m_tokens[m_curr].type() == type;
+    return m_token.type() == type;
 }
 
 void Parser::forward() {
     if (!at_eof()) {
-        m_curr++;
+        m_token = m_lexer->next();
     }
 }
 
@@ -115,7 +233,7 @@ void Parser::open_attribute_map(std::string const &name) {
 bool Parser::has_next_attribute() {
     auto &attr_map = m_opened.back();
     if (!attr_map.empty()) {
-        Token &comma = accept(TokenType::Comma);
+        Token comma = accept(TokenType::Comma);
         if (matches(TokenType::RBrace)) {
             return false;
         } else {
@@ -129,29 +247,29 @@ bool Parser::has_next_attribute() {
     return !matches(TokenType::RBrace);
 }
 
-Token &Parser::parse_attribute() {
+Token Parser::parse_attribute() {
     auto &attr_map = m_opened.back();
 
-    Token &attr = expect(TokenType::Identifier);
-    auto const &iter = attr_map.find(attr.lexeme());
+    Token attr = expect(TokenType::Identifier);
+    auto const &iter = attr_map.find(lexeme(attr));
     if (iter != attr_map.end()) {
         std::stringstream ss;
-        ss << "attribute '" << attr << "' was already declared";
+        ss << "attribute '" << lexeme(attr) << "' was already declared";
         throw std::runtime_error(ss.str());
     }
 
-    attr_map.insert(attr.lexeme());
+    attr_map.insert(lexeme(attr));
 
     expect(TokenType::Colon);
     
     return attr;
 }
 
-void Parser::unknown_attribute(Token &attr) {
+void Parser::unknown_attribute(Token const &attr) {
     std::stringstream ss;
-    ss << "attribute '" << attr.lexeme() << "' is not recognized for '" 
+    ss << "attribute '" << lexeme(attr) << "' is not recognized for '" 
        << m_opened_names.back() << "'";
-    attr.error(ss.str());
+    error(attr, ss.str());
 }
 
 void Parser::close_attribute_map() {
@@ -185,32 +303,57 @@ bool Parser::is_list_end() {
 void Parser::parse_let_declaration() {
     expect(TokenType::Let);
     
-    Token &name = expect(TokenType::Identifier);
+    Token name = expect(TokenType::Identifier);
     check_shadowed_definition(name);
 
     expect(TokenType::Equals);
+    std::size_t begin = m_token.offset();
+    m_deps.clear();
     double value = parse_double_expression();
+    bind(lexeme(name), nullptr, -1, begin);
     expect(TokenType::Semicolon);
 
-    m_named_consts[name.lexeme()] = value;
+    m_named_consts[lexeme(name)] = value;
 }
 
-std::unique_ptr<AnalogChip> Parser::parse_chip() {
-    expect(TokenType::Chip);
+std::unique_ptr<AnalogChip> Parser::parse_chip(std::size_t index) {
+    Token keyword = expect(TokenType::Chip);
 
-    auto chip = std::make_unique<AnalogChip>();
+    auto chip = m_pool ? m_pool->acquire() : std::make_unique<AnalogChip>();
     m_chip_cams = {};
+    m_unplaced.clear();
+    m_links.clear();
+
+    if (m_cache) {
+        m_cache->chip(*chip);
+    }
+
+    uint32_t seed = 1;
+
+    /* Chips are addressed by their position unless given an address,
+       which only the first 255 chips can be */
+    bool addressed = false;
+    if (index < 0xFF) {
+        chip->set_address(index + 1);
+    }
 
     open_attribute_map("chip");
 
     while (has_next_attribute()) {
-        Token &attr = parse_attribute();
-        if (attr == "io") {
+        Token attr = parse_attribute();
+        if (lexeme(attr) == "io") {
             parse_io_modes(*chip);
-        } else if (attr == "cabs") {
+        } else if (lexeme(attr) == "cabs") {
             parse_cabs_list(*chip);
-        } else if (attr == "routing") {
+        } else if (lexeme(attr) == "routing") {
             parse_routing(*chip);
+        } else if (lexeme(attr) == "address") {
+            chip->set_address(
+                    parse_ranged_integer_expression(1, 0xFF, "chip address"));
+            addressed = true;
+        } else if (lexeme(attr) == "placement_seed") {
+            seed = parse_ranged_integer_expression(0, UINT32_MAX, 
+                                                   "placement seed");
         } else {
             unknown_attribute(attr);
         }
@@ -218,6 +361,24 @@ std::unique_ptr<AnalogChip> Parser::parse_chip() {
 
     close_attribute_map();
 
+    if (!addressed && index >= 0xFF) {
+        std::stringstream ss;
+        ss << "chip " << index + 1 << " needs an address, only the first "
+           << 0xFF << " chips have a default one";
+        error(keyword, ss.str());
+    }
+
+    /* Links are connected in source order once all CAMs are on CABs */
+    place_cams(*chip, seed);
+    for (PendingLink const &link : m_links) {
+        connect(link);
+    }
+
+    /* The address is final once all attributes were parsed */
+    if (m_cache) {
+        m_cache->address(chip->address());
+    }
+
     return chip;
 }
 
@@ -236,15 +397,19 @@ void Parser::parse_io_modes(AnalogChip &chip) {
         }
 
         if (!accept(TokenType::Minus)) {
-            Token &mode = expect(TokenType::Identifier);
-            if (mode == "input") {
+            Token mode = expect(TokenType::Identifier);
+            if (lexeme(mode) == "input") {
                 chip.io_cell(i).set_mode(IOMode::InputBypass);
-            } else if (mode == "output") {
+            } else if (lexeme(mode) == "output") {
                 chip.io_cell(i).set_mode(IOMode::OutputBypass);
             } else {
                 std::stringstream ss;
-                ss << "unknown mode: '" << mode << "'";
-                throw std::runtime_error(ss.str());
+                ss << "unknown mode: '" << lexeme(mode) << "'";
+                error(mode, ss.str());
+            }
+
+            if (m_cache) {
+                m_cache->io_mode(i, chip.io_cell(i).mode());
             }
         }
 
@@ -262,14 +427,8 @@ void Parser::parse_cabs_list(AnalogChip &chip) {
     }
 
     while (true) {
-        expect(TokenType::Cab);
-
-        int32_t id = 
-                parse_ranged_integer_expression(1, NBlocksPerChip, "cab id");
-
-        AnalogBlock &cab = chip.cab(id);
-        parse_cab_setup(chip, cab);
-        parse_cab(cab);
+        CamSite site = parse_cab_site(chip);
+        parse_cab(chip, site);
         
         if (is_list_end()) {
             return;
@@ -277,7 +436,16 @@ void Parser::parse_cabs_list(AnalogChip &chip) {
     }
 }
 
-void Parser::parse_cab_setup(AnalogChip &chip, AnalogBlock &cab) {
+Parser::CamSite Parser::parse_cab_site(AnalogChip &chip) {
+    expect(TokenType::Cab);
+
+    AnalogBlock *cab = nullptr;
+    if (!matches(TokenType::With)) {
+        int32_t id = 
+                parse_ranged_integer_expression(1, NBlocksPerChip, "cab id");
+        cab = &chip.cab(id);
+    }
+
     expect(TokenType::With);
     expect(TokenType::Clocks);
 
@@ -285,7 +453,15 @@ void Parser::parse_cab_setup(AnalogChip &chip, AnalogBlock &cab) {
     expect(TokenType::Comma);
     Clock &clk_b = parse_clock_id(chip);
 
-    cab.setup(clk_a, clk_b);
+    if (cab) {
+        cab->setup(clk_a, clk_b);
+
+        if (m_cache) {
+            m_cache->cab_setup(cab->id(), clk_a.id(), clk_b.id());
+        }
+    }
+
+    return { cab, &clk_a, &clk_b };
 }
 
 Clock &Parser::parse_clock_id(AnalogChip &chip) {
@@ -297,13 +473,13 @@ Clock &Parser::parse_clock_id(AnalogChip &chip) {
     return chip.clock(id);
 }
 
-void Parser::parse_cab(AnalogBlock &cab) {
+void Parser::parse_cab(AnalogChip &chip, CamSite const &site) {
     open_attribute_map("cab");
 
     while (has_next_attribute()) {
-        Token &attr = parse_attribute();
-        if (attr == "cams") {
-            parse_cam_list(cab);
+        Token attr = parse_attribute();
+        if (lexeme(attr) == "cams") {
+            parse_cam_list(chip, site);
         } else {
             unknown_attribute(attr);
         }
@@ -312,13 +488,13 @@ void Parser::parse_cab(AnalogBlock &cab) {
     close_attribute_map();
 }
 
-void Parser::parse_cam_list(AnalogBlock &cab) {
+void Parser::parse_cam_list(AnalogChip &chip, CamSite const &site) {
     if (!open_list()) {
         return;
     }
 
     while (true) {
-        parse_cam(cab);
+        parse_cam(chip, site);
         
         if (is_list_end()) {
             return;
@@ -326,41 +502,129 @@ void Parser::parse_cam_list(AnalogBlock &cab) {
     }
 }
 
-void Parser::parse_cam(AnalogBlock &cab) {
-    Token &name = expect(TokenType::Identifier);
+void Parser::parse_cam(AnalogChip &chip, CamSite const &site) {
+    Token name = expect(TokenType::Identifier);
     expect(TokenType::As);
-    Token &key = expect(TokenType::Identifier);
+    Token key = expect(TokenType::Identifier);
 
-    AnalogModule *cam = AnalogModule::Build(name.lexeme());
+    AnalogModule *cam = AnalogModule::Build(lexeme(name), 
+                                            site.cab ? &chip.arena() : nullptr);
 
     if (!cam) {
         std::stringstream ss;
-        ss << "undefined CAM name: " << name.lexeme();
-        name.error(ss.str());
+        ss << "undefined CAM name: " << lexeme(name);
+        error(name, ss.str());
+    }
+
+    UnplacedCam *unplaced = nullptr;
+    if (site.cab) {
+        site.cab->add_raw(cam);
+    } else {
+        m_unplaced.push_back({ std::unique_ptr<AnalogModule>(cam), 
+                               lexeme(name), site.clk_a, site.clk_b, {} });
+        unplaced = &m_unplaced.back();
     }
-    cab.add_raw(cam);
 
-    if (m_chip_cams.find(key.lexeme()) != m_chip_cams.end()) {
+    if (m_chip_cams.find(lexeme(key)) != m_chip_cams.end()) {
         std::stringstream ss;
-        ss << "shadowed CAM key: " << name.lexeme();
-        key.error(ss.str());
+        ss << "shadowed CAM key: " << lexeme(name);
+        error(key, ss.str());
     }
 
-    m_chip_cams[key.lexeme()] = cam;
+    m_chip_cams[lexeme(key)] = cam;
+    cam->set_key(lexeme(key));
+
+    if (m_cache && !unplaced) {
+        m_cache->cam(cam, site.cab->id(), lexeme(name), lexeme(key));
+    }
 
-    open_attribute_map(std::string(name.lexeme()));
+    open_attribute_map(std::string(lexeme(name)));
 
     while (has_next_attribute()) {
-        Token &attr = parse_attribute();
+        Token attr = parse_attribute();
+        std::size_t begin = m_token.offset();
+        m_deps.clear();
         double value = parse_double_expression();
-        if (!cam->set_parameter(attr.lexeme(), Parameter(value))) {
+
+        int id = cam->parameter_id(lexeme(attr));
+        if (id < 0) {
             unknown_attribute(attr);
         }
+        cam->set_parameter(id, value);
+        if (m_cache && unplaced) {
+            unplaced->parameters.emplace_back(id, value);
+        } else if (m_cache) {
+            m_cache->parameter(id, value);
+        }
+
+        /* The placement depends on every parameter of an unplaced CAM 
+           which determines its components */
+        if (cam->is_structural(id)) {
+            m_structural_consts.insert(m_deps.begin(), m_deps.end());
+        }
+        bind(lexeme(attr), cam, id, begin);
     }
 
     close_attribute_map();
 
+    if (unplaced) {
+        return;
+    }
+
+    PhaseTimer claim_timer(Phase::ClaimComponents);
     cam->claim_components();
+
+    if (m_cache) {
+        m_cache->claim();
+    }
+}
+
+/* Puts the unplaced CAMs on the CABs the Placer picks, setting up unused 
+   CABs with their clocks, as if they had been declared there */
+void Parser::place_cams(AnalogChip &chip, uint32_t seed) {
+    if (m_unplaced.empty()) {
+        return;
+    }
+
+    Placer placer(chip, seed);
+    for (UnplacedCam const &unplaced : m_unplaced) {
+        placer.add_cam(*unplaced.cam, *unplaced.clk_a, *unplaced.clk_b);
+    }
+    for (PendingLink const &link : m_links) {
+        placer.add_link(*link.out.cam, *link.in.cam);
+    }
+
+    std::vector<int> cab_ids = placer.place();
+
+    for (std::size_t i = 0; i < m_unplaced.size(); i++) {
+        UnplacedCam &unplaced = m_unplaced[i];
+        AnalogBlock &cab = chip.cab(cab_ids[i]);
+
+        if (!cab.is_set_up()) {
+            cab.setup(*unplaced.clk_a, *unplaced.clk_b);
+            if (m_cache) {
+                m_cache->cab_setup(cab.id(), unplaced.clk_a->id(), 
+                                   unplaced.clk_b->id());
+            }
+        }
+
+        AnalogModule *cam = cab.add_raw(unplaced.cam.release());
+        if (m_cache) {
+            m_cache->cam(cam, cab.id(), unplaced.name, cam->key());
+            for (auto const &[id, value] : unplaced.parameters) {
+                m_cache->parameter(id, value);
+            }
+        }
+
+        PhaseTimer claim_timer(Phase::ClaimComponents);
+        cam->claim_components();
+
+        if (m_cache) {
+            m_cache->claim();
+        }
+    }
+
+    m_unplaced.clear();
 }
 
 void Parser::parse_routing(AnalogChip &chip) {
@@ -378,38 +642,59 @@ void Parser::parse_routing(AnalogChip &chip) {
 }
 
 void Parser::parse_routing_entry(AnalogChip &chip) {
-    OutputPort &out = parse_output_port(chip);
-    Token &arrow = expect(TokenType::Arrow);
-    InputPort &in = parse_input_port(chip);
-    try {
-        out.connect(in);
-    } catch (std::exception const &e) {
-        arrow.error(e.what());
-    }
+    PortRef out = parse_output_port(chip);
+    Token arrow = expect(TokenType::Arrow);
+    PortRef in = parse_input_port(chip);
+    m_links.push_back({ out, in, arrow });
 }
 
-OutputPort &Parser::parse_output_port(AnalogChip &chip) {
-    Token &name = expect(TokenType::Identifier);
+Parser::PortRef Parser::parse_output_port(AnalogChip &chip) {
+    Token name = expect(TokenType::Identifier);
     AnalogModule *cam = find_cam(chip, name);
+    int64_t port = 0;
     if (accept(TokenType::Colon)) {
-        int64_t port = parse_integer_expression();
-        return cam->out(port); // fixme 
+        port = parse_integer_expression();
     }
-    return cam->out();
+
+    return { cam, static_cast<std::size_t>(port), false };
 }
 
-InputPort &Parser::parse_input_port(AnalogChip &chip) {
-    Token &name = expect(TokenType::Identifier);
+Parser::PortRef Parser::parse_input_port(AnalogChip &chip) {
+    Token name = expect(TokenType::Identifier);
     AnalogModule *cam = find_cam(chip, name);
+    bool comparator = false;
+    int64_t port = 0;
     if (accept(TokenType::Colon)) {
-        if (accept(TokenType::Cmp)) {
-            return cam->comp().in();
-        } else {
-            int64_t port = parse_integer_expression();
-            return cam->in(port); // fixme 
+        comparator = accept(TokenType::Cmp);
+        if (!comparator) {
+            port = parse_integer_expression();
         }
     }
-    return cam->in();
+
+    return { cam, static_cast<std::size_t>(port), comparator };
+}
+
+void Parser::connect(PendingLink const &link) {
+    AnalogModule *out_cam = link.out.cam;
+    OutputPort &out = out_cam->out(link.out.port); // fixme 
+    if (m_cache) {
+        m_cache->output(out_cam, link.out.port);
+    }
+
+    AnalogModule *in_cam = link.in.cam;
+    InputPort &in = link.in.comparator ? in_cam->comp().in() 
+                                       : in_cam->in(link.in.port); // fixme 
+    if (m_cache) {
+        m_cache->input(in_cam, link.in.comparator 
+                                   ? design_cache::ComparatorPort 
+                                   : link.in.port);
+    }
+
+    try {
+        out.connect(in);
+    } catch (std::exception const &e) {
+        error(link.arrow, e.what());
+    }
 }
 
 double Parser::parse_expression() {
@@ -450,13 +735,13 @@ double Parser::parse_unary() {
 }
 
 double Parser::parse_atom() {
-    if (Token &num = accept(TokenType::Number)) {
+    if (Token num = accept(TokenType::Number)) {
         try {
-            return std::stod(std::string(num.lexeme())); // todo improve stod
+            return std::stod(std::string(lexeme(num))); // todo improve stod
         } catch (...) {
             std::stringstream ss;
-            ss << "malformed number: " << num.lexeme();
-            num.error(ss.str());
+            ss << "malformed number: " << lexeme(num);
+            error(num, ss.str());
         }
     } 
     if (accept(TokenType::True)) {
@@ -465,13 +750,14 @@ double Parser::parse_atom() {
     if (accept(TokenType::False)) {
         return 0.0;
     } 
-    if (Token &name = accept(TokenType::Identifier)) {
-        auto iter = m_named_consts.find(name.lexeme());
+    if (Token name = accept(TokenType::Identifier)) {
+        auto iter = m_named_consts.find(lexeme(name));
         if (iter == m_named_consts.end()) {
             std::stringstream ss;
-            ss << "'" << name.lexeme() << "' is not a defined constant";
-            name.error(ss.str());
+            ss << "'" << lexeme(name) << "' is not a defined constant";
+            error(name, ss.str());
         }
+        m_deps.push_back(iter->first);
         return iter->second;
     }
     expect_error("atom");
@@ -492,7 +778,13 @@ int64_t Parser::parse_ranged_integer_expression(int64_t lo, int64_t hi,
 }
 
 int64_t Parser::parse_integer_expression() {
-    return std::llround(parse_expression());
+    /* Integer expressions select chip resources, which cannot be swept */
+    m_deps.clear();
+    int64_t value = std::llround(parse_expression());
+    m_structural_consts.insert(m_deps.begin(), m_deps.end());
+    m_deps.clear();
+
+    return value;
 }
 
 double Parser::parse_double_expression() {
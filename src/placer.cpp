@@ -0,0 +1,336 @@
+#include "placer.hpp"
+#include "analog-chip.hpp"
+#include "analog-block.hpp"
+#include "io-cell.hpp"
+#include "error.hpp"
+#include "time-report.hpp"
+#include <algorithm>
+#include <sstream>
+#include <random>
+#include <cmath>
+
+/* Annealing schedule: a few hundred moves per CAM, cooling geometrically
+   from a temperature that accepts detours of a couple of channels */
+static constexpr std::size_t StepsPerCam = 400;
+static constexpr double InitialTemperature = 8.0;
+static constexpr double FinalTemperature = 0.1;
+
+/* Cost of a bi-indirect channel pair or local input pair driven by more
+   than two output ports, which the router cannot assign */
+static constexpr int Overload = 16;
+
+/* Kinds of channels in the keys of cost(), see Channel::Type */
+enum ChannelKey : uint32_t {
+    InputDirect,
+    OutputDirect,
+    BiIndirect,
+    LocalInput,
+    LocalOutput,
+    InterCab,
+    IntraCab,
+};
+
+static uint32_t channel_key(ChannelKey kind, int a, int b, int driver) {
+    return kind << 24 | a << 16 | b << 8 | driver;
+}
+
+/* Uniform in [0, 1), from the generator alone so that placements do not
+   depend on the standard library */
+static double unit(std::mt19937 &rng) {
+    return (rng() >> 8) * (1.0 / (1 << 24));
+}
+
+Placer::Placer(AnalogChip &chip, uint32_t seed)
+        : m_chip{chip}, m_seed{seed}, m_cams{}, m_links{}, m_drivers{},
+          m_assign{}, m_order{}, m_keys{}, m_direct{}, m_columns{} {
+    for (int cab = 1; cab <= NBlocksPerChip; cab++) {
+        m_columns[cab] = static_cast<int>(
+                Channel::to_cab_column(m_chip.cab(cab)));
+        for (int cell = 1; cell <= NType1IOCellsPerChip; cell++) {
+            m_direct[cell][cab] = Channel::uses_direct_channel(
+                    m_chip.io_cell(cell), m_chip.cab(cab));
+        }
+    }
+}
+
+void Placer::add_cam(AnalogModule &cam, Clock &clk_a, Clock &clk_b) {
+    m_cams.push_back({ &cam, cam.resources(), &clk_a, &clk_b });
+    m_assign.push_back(0);
+}
+
+void Placer::add_link(AnalogModule &from, AnalogModule &to) {
+    m_links.push_back({ node(from), node(to), driver(from) });
+}
+
+Placer::Node Placer::node(AnalogModule &module) {
+    for (int cell = 1; cell <= NType1IOCellsPerChip; cell++) {
+        if (&module == &m_chip.io_cell(cell)) {
+            return { Kind::Cell, cell };
+        }
+    }
+
+    for (std::size_t i = 0; i < m_cams.size(); i++) {
+        if (m_cams[i].module == &module) {
+            return { Kind::Cam, static_cast<int>(i) };
+        }
+    }
+
+    return { Kind::Cab, module.cab().id() };
+}
+
+int Placer::driver(AnalogModule &module) {
+    auto iter = std::find(m_drivers.begin(), m_drivers.end(), &module);
+    if (iter != m_drivers.end()) {
+        return iter - m_drivers.begin();
+    }
+
+    m_drivers.push_back(&module);
+    return m_drivers.size() - 1;
+}
+
+std::vector<int> Placer::place() {
+    PhaseTimer timer(Phase::Place);
+
+    if (m_cams.empty()) {
+        return {};
+    }
+
+    /* Largest CAMs first, so that a full chip is filled without much
+       backtracking */
+    m_order.resize(m_cams.size());
+    for (std::size_t k = 0; k < m_order.size(); k++) {
+        m_order[k] = k;
+    }
+    std::stable_sort(m_order.begin(), m_order.end(),
+        [&](std::size_t a, std::size_t b) {
+            return m_cams[a].resources.capacitors
+                 > m_cams[b].resources.capacitors;
+        });
+
+    if (!search(0)) {
+        std::stringstream ss;
+        ss << "could not place the CAMs:";
+        for (Cam const &cam : m_cams) {
+            ss << " " << cam.module->key();
+        }
+        ss << " (not enough components on CABs with their clocks)";
+        throw DesignError(ss.str());
+    }
+
+    std::mt19937 rng(m_seed);
+
+    int cost = this->cost();
+    int best_cost = cost;
+    std::vector<int> best = m_assign;
+
+    std::size_t n_steps = StepsPerCam * m_cams.size();
+    double cooling = std::pow(FinalTemperature / InitialTemperature,
+                              1.0 / n_steps);
+    double temperature = InitialTemperature;
+
+    for (std::size_t step = 0; step < n_steps && best_cost > 0; step++) {
+        temperature *= cooling;
+
+        std::size_t i = rng() % m_cams.size();
+        int to = 1 + rng() % NBlocksPerChip;
+        int from = m_assign[i];
+        if (to == from) {
+            continue;
+        }
+
+        /* Either move the CAM, or swap it with one on the other CAB */
+        int j = -1;
+        if (rng() % 2) {
+            std::size_t n_there = std::count(m_assign.begin(),
+                                             m_assign.end(), to);
+            if (n_there > 0) {
+                std::size_t k = rng() % n_there;
+                for (std::size_t c = 0; c < m_assign.size(); c++) {
+                    if (m_assign[c] == to && k-- == 0) {
+                        j = c;
+                        break;
+                    }
+                }
+            }
+        }
+
+        m_assign[i] = to;
+        if (j >= 0) {
+            m_assign[j] = from;
+        }
+
+        bool accept = false;
+        if (fits(from) && fits(to)) {
+            int next = this->cost();
+            int delta = next - cost;
+            accept = delta <= 0
+                  || unit(rng) < std::exp(-delta / temperature);
+            if (accept) {
+                cost = next;
+            }
+        }
+
+        if (!accept) {
+            m_assign[i] = from;
+            if (j >= 0) {
+                m_assign[j] = to;
+            }
+        } else if (cost < best_cost) {
+            best_cost = cost;
+            best = m_assign;
+        }
+    }
+
+    return best;
+}
+
+bool Placer::fits(int id) const {
+    AnalogBlock &cab = m_chip.cab(id);
+
+    Clock *clk_a = nullptr, *clk_b = nullptr;
+    if (cab.is_set_up()) {
+        clk_a = &cab.get_clock(Clock::A);
+        clk_b = &cab.get_clock(Clock::B);
+    }
+
+    Resources used{};
+    for (std::size_t i = 0; i < m_cams.size(); i++) {
+        if (m_assign[i] != id) {
+            continue;
+        }
+
+        Cam const &cam = m_cams[i];
+        if (!clk_a) {
+            clk_a = cam.clk_a;
+            clk_b = cam.clk_b;
+        } else if (cam.clk_a != clk_a || cam.clk_b != clk_b) {
+            return false;
+        }
+
+        used.capacitors += cam.resources.capacitors;
+        used.opamps += cam.resources.opamps;
+        used.comparators += cam.resources.comparators;
+        used.inputs += cam.resources.inputs;
+    }
+
+    Resources free = cab.available();
+    return used.capacitors <= free.capacitors && used.opamps <= free.opamps
+        && used.comparators <= free.comparators && used.inputs <= free.inputs;
+}
+
+/* Assigns the CAMs from the i-th in m_order on, leaving earlier ones in 
+   place */
+bool Placer::search(std::size_t i) {
+    if (i == m_order.size()) {
+        return true;
+    }
+
+    std::size_t cam = m_order[i];
+    for (int cab = 1; cab <= NBlocksPerChip; cab++) {
+        m_assign[cam] = cab;
+        if (fits(cab) && search(i + 1)) {
+            return true;
+        }
+    }
+
+    m_assign[cam] = 0;
+    return false;
+}
+
+/* Twice the number of channels the links occupy with the current 
+   placement, plus one per local input channel, so that of two placements 
+   with as many channels the one with fewer detours over the bi-indirect 
+   channels wins, plus a penalty for each output port too many on a pair 
+   of channels. Links from the same output port share channels, so every 
+   channel is counted once per driver, as a key of its kind, location and 
+   driver. */
+int Placer::cost() {
+    m_keys.clear();
+
+    auto key = [&](ChannelKey kind, int a, int b, int driver) {
+        m_keys.push_back(channel_key(kind, a, b, driver));
+    };
+
+    /* An input cell reaches all CABs of a column indirectly if it cannot
+       reach one of them directly, see Router::add_input_cell */
+    std::array<std::array<bool, 2>, NCells + 1> indirect{};
+    for (Link const &link : m_links) {
+        if (link.from.kind == Kind::Cell && link.to.kind != Kind::Cell) {
+            int cell = link.from.id;
+            int to = cab_of(link.to);
+            indirect[cell][m_columns[to]] |= !m_direct[cell][to];
+        }
+    }
+
+    for (Link const &link : m_links) {
+        int d = link.driver;
+
+        if (link.from.kind == Kind::Cell) {
+            if (link.to.kind == Kind::Cell) {
+                continue;
+            }
+
+            int cell = link.from.id;
+            int to = cab_of(link.to);
+            if (!indirect[cell][m_columns[to]]) {
+                key(InputDirect, cell, to, d);
+            } else {
+                key(BiIndirect, m_columns[to], 0, d);
+                key(LocalInput, to, 0, d);
+            }
+            continue;
+        }
+
+        int from = cab_of(link.from);
+        if (link.to.kind == Kind::Cell) {
+            int cell = link.to.id;
+            if (m_direct[cell][from]) {
+                key(OutputDirect, cell, 0, d);
+            } else {
+                key(LocalOutput, from, 0, d);
+                key(BiIndirect, m_columns[from], 0, d);
+            }
+            continue;
+        }
+
+        /* Only CAB 3 loops back to itself over the bi-indirect channels */
+        int to = cab_of(link.to);
+        if (from != to) {
+            key(InterCab, from, to, d);
+        } else if (from != 3) {
+            key(IntraCab, from, 0, d);
+        } else {
+            key(LocalOutput, from, 0, d);
+            key(BiIndirect, m_columns[from], 0, d);
+            key(LocalInput, from, 0, d);
+        }
+    }
+
+    std::sort(m_keys.begin(), m_keys.end());
+    m_keys.erase(std::unique(m_keys.begin(), m_keys.end()), m_keys.end());
+
+    /* Drivers per bi-indirect column and per CAB local input pair */
+    std::array<int, 2> bi_drivers{};
+    std::array<int, NCabs + 1> local_drivers{};
+    for (uint32_t k : m_keys) {
+        uint32_t kind = k >> 24;
+        int a = (k >> 16) & 0xFF;
+        if (kind == BiIndirect) {
+            bi_drivers[a]++;
+        } else if (kind == LocalInput) {
+            local_drivers[a]++;
+        }
+    }
+
+    int cost = 2 * m_keys.size();
+    for (int n : local_drivers) {
+        cost += n;
+    }
+    for (int n : bi_drivers) {
+        cost += Overload * std::max(n - 2, 0);
+    }
+    for (int n : local_drivers) {
+        cost += Overload * std::max(n - 2, 0);
+    }
+    return cost;
+}
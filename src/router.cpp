@@ -0,0 +1,597 @@
+#include "router.hpp"
+#include "matching.hpp"
+#include "analog-chip.hpp"
+#include "analog-block.hpp"
+#include "io-cell.hpp"
+#include "io-port.hpp"
+#include "error.hpp"
+#include "time-report.hpp"
+#include <algorithm>
+#include <sstream>
+#include <cassert>
+
+static constexpr Channel::Side Sides[] = { Channel::Primary,
+                                           Channel::Secondary };
+
+Router::Router(AnalogChip &chip)
+        : m_chip{chip}, m_channels{}, m_requests{},
+          m_state{}, m_driver_owners{}, m_wires{}, m_wire_owners{},
+          m_used{}, m_used_owners{}, m_trail{},
+          m_order{}, m_candidates{}, m_cursors{}, m_marks{},
+          m_conflicts{}, m_choices{} {
+    m_requests.reserve(MaxLinks);
+}
+
+void Router::route() {
+    for (int i = 1; i <= NType1IOCellsPerChip; i++) {
+        IOCell &cell = m_chip.io_cell(i);
+        if (cell.mode() == IOMode::InputBypass) {
+            add_input_cell(cell);
+        } else if (cell.mode() == IOMode::OutputBypass) {
+            add_output_cell(cell);
+        }
+    }
+
+    for (int i = 1; i <= NBlocksPerChip; i++) {
+        add_cab(m_chip.cab(i));
+    }
+
+    /* Channels may be reserved before routing, see Comparator::finalize */
+    m_state = m_chip.routing_state();
+    m_driver_owners.fill(-1);
+    m_wires.fill(-1);
+    m_wire_owners.fill(-1);
+    m_used.fill(-1);
+    m_used_owners.fill(-1);
+
+    check();
+
+    LinkSet all;
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        all.set(i);
+    }
+
+    if (!solve(all)) {
+        fail();
+    }
+    apply();
+}
+
+void Router::add_input_cell(IOCell &cell) {
+    IOGroup group = Channel::to_io_group(cell);
+
+    /* All links to a CAB column share the channel the IO cell drives */
+    bool use_indirect[2] = { false, false };
+    for (PortLink *link = cell.out().links(); link; link = link->next) {
+        AnalogBlock &cab = link->in->cab();
+        CabColumn cab_group = Channel::to_cab_column(cab);
+        bool direct = Channel::uses_direct_channel(cell, cab);
+
+        std::size_t i = static_cast<int>(cab_group);
+        use_indirect[i] = use_indirect[i] || !direct;
+    }
+
+    for (PortLink *link = cell.out().links(); link; link = link->next) {
+        AnalogBlock &cab = link->in->cab();
+        CabColumn cab_group = Channel::to_cab_column(cab);
+        bool direct = !use_indirect[static_cast<int>(cab_group)];
+
+        Request &request = add_request(*link, true);
+        for (Channel::Side side : Sides) {
+            if (direct) {
+                Channel &input = m_chip.global_input_direct(group, cab, side);
+
+                Route &route = add_route(request);
+                choose(route, 0, input, side);
+                hop(route, input);
+                use(route, cell, cab_group, input);
+                continue;
+            }
+
+            /* IOx -> GlobalY -> InputZ */
+            for (Channel::Side local_side : Sides) {
+                Channel &input = m_chip.global_bi_indirect(cab_group, side);
+                Channel &local = cab.local_input_channel(local_side);
+
+                Route &route = add_route(request);
+                choose(route, 0, input, side);
+                choose(route, 1, local, local_side);
+                hop(route, input);
+                hop(route, local);
+                wire(route, local, input);
+                use(route, cell, cab_group, input);
+            }
+        }
+    }
+}
+
+void Router::add_output_cell(IOCell &cell) {
+    PortLink *link = cell.in().link();
+    if (!link) {
+        return;
+    }
+
+    IOGroup group = Channel::to_io_group(cell);
+    AnalogBlock &cab = link->out->cab();
+    CabColumn cab_group = Channel::to_cab_column(cab);
+    Channel::Side side = Channel::source_to_side(link->out->source());
+
+    Request &request = add_request(*link, true);
+    if (Channel::uses_direct_channel(cell, cab)) {
+        Channel &output = m_chip.global_output_direct(group, cab, side);
+
+        Route &route = add_route(request);
+        hop(route, output);
+        use(route, cell, cab_group, output);
+        return;
+    }
+
+    /* OpAmpX -> OutputX -> GlobalY -> IOz */
+    for (Channel::Side global_side : Sides) {
+        Channel &local = cab.local_output_channel(side);
+        Channel &output = m_chip.global_bi_indirect(cab_group, global_side);
+
+        Route &route = add_route(request);
+        choose(route, 0, output, global_side);
+        hop(route, local);
+        hop(route, output);
+        wire(route, local, output);
+        use(route, cell, cab_group, output);
+    }
+}
+
+void Router::add_cab(AnalogBlock &cab) {
+    for (InputPort &in : cab.local_ins()) {
+        if (!in.connected()) {
+            continue;
+        }
+
+        PortLink &link = *in.link();
+        OutputPort &out = *link.out;
+
+        /* Links from IO cells are routed with the cell */
+        if (out.source() != OutPortSource::OpAmp1
+                && out.source() != OutPortSource::OpAmp2) {
+            continue;
+        }
+
+        Channel::Side side = Channel::source_to_side(out.source());
+
+        if (!(out.cab() == in.cab())) {
+            Route &route = add_route(add_request(link, false));
+            hop(route, m_chip.intercam_channel(out.cab(), in.cab(), side));
+            continue;
+        }
+
+        /* CAB3 has no local op-amp channels */
+        if (cab.id() != 3) {
+            Route &route = add_route(add_request(link, false));
+            hop(route, cab.local_opamp_channel(side));
+            continue;
+        }
+
+        /* OpAmpX -> OutputX -> GlobalY -> InputZ */
+        CabColumn group = Channel::to_cab_column(cab);
+        Request &request = add_request(link, false);
+        for (Channel::Side global_side : Sides) {
+            for (Channel::Side local_side : Sides) {
+                Channel &output = cab.local_output_channel(side);
+                Channel &global = m_chip.global_bi_indirect(group, global_side);
+                Channel &input = cab.local_input_channel(local_side);
+
+                Route &route = add_route(request);
+                choose(route, 0, global, global_side);
+                choose(route, 1, input, local_side);
+                hop(route, output);
+                hop(route, global);
+                hop(route, input);
+                wire(route, input, global);
+                wire(route, output, global);
+            }
+        }
+    }
+}
+
+Router::Request &Router::add_request(PortLink &link, bool prefer_driven) {
+    if (m_requests.size() == MaxLinks) {
+        throw DesignError("too many links to route");
+    }
+
+    Request &request = m_requests.emplace_back();
+    request.link = &link;
+    request.n_routes = 0;
+    request.prefer_driven = prefer_driven;
+    return request;
+}
+
+Router::Route &Router::add_route(Request &request) {
+    assert(request.n_routes < MaxRoutes);
+
+    Route &route = request.routes[request.n_routes++];
+    route.n_channels = 0;
+    route.n_wires = 0;
+    route.used_slot = -1;
+    route.used = -1;
+    route.choices = { -1, -1 };
+    route.sides = { Channel::Primary, Channel::Primary };
+    return route;
+}
+
+int Router::index(Channel &channel) {
+    assert(channel.state == &m_chip.routing_state());
+
+    m_channels[channel.id] = &channel;
+    return channel.id;
+}
+
+void Router::hop(Route &route, Channel &channel) {
+    route.channels[route.n_channels++] = index(channel);
+}
+
+void Router::choose(Route &route, std::size_t i, Channel &channel,
+                    Channel::Side side) {
+    route.choices[i] = index(channel);
+    route.sides[i] = side;
+}
+
+void Router::wire(Route &route, Channel &local, Channel &global) {
+    route.wires[route.n_wires++] = { index(local), index(global) };
+}
+
+void Router::use(Route &route, IOCell &cell, CabColumn column,
+                 Channel &channel) {
+    route.used_slot = 2 * (cell.id() - 1) + static_cast<int>(column);
+    route.used = index(channel);
+}
+
+/* Finds a route for every enabled request. On success, the routes stay
+   assigned in the search state and m_choices; on failure, the search
+   state is left as it was. */
+bool Router::solve(LinkSet const &enabled) {
+    std::size_t n = 0;
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        if (enabled[i]) {
+            m_order[n++] = i;
+        }
+    }
+    if (n == 0) {
+        return true;
+    }
+
+    std::size_t depth = 0;
+    order_routes(depth, m_order[depth]);
+
+    while (true) {
+        std::size_t i = m_order[depth];
+        Request const &request = m_requests[i];
+
+        bool assigned = false;
+        while (m_cursors[depth] < request.n_routes) {
+            std::size_t r = m_candidates[depth][m_cursors[depth]++];
+            if (assign(i, request.routes[r], m_conflicts[depth])) {
+                m_choices[i] = r;
+                assigned = true;
+                break;
+            }
+        }
+
+        if (assigned) {
+            if (++depth == n) {
+                return true;
+            }
+            order_routes(depth, m_order[depth]);
+            continue;
+        }
+
+        /* No route left: jump back to the latest request in the way */
+        LinkSet conflict = m_conflicts[depth];
+        if (conflict.none()) {
+            undo(m_marks[0]);
+            return false;
+        }
+
+        std::size_t h = depth;
+        do {
+            h--;
+        } while (!conflict[m_order[h]]);
+
+        conflict.reset(m_order[h]);
+        m_conflicts[h] |= conflict;
+        undo(m_marks[h]);
+        depth = h;
+    }
+}
+
+/* Starts a request at a depth of the search, ordering its routes as
+   the greedy router would have tried them */
+void Router::order_routes(std::size_t depth, std::size_t i) {
+    Request const &request = m_requests[i];
+    OutputPort *out = request.link->out;
+
+    auto rank = [&](Route const &route) {
+        int rank = 0;
+        for (std::size_t k = 0; k < route.choices.size(); k++) {
+            int channel = route.choices[k];
+            bool driven = channel >= 0 && request.prefer_driven
+                       && m_state.driver(channel) == out;
+            rank = rank << 2 | !driven << 1 | route.sides[k];
+        }
+        return rank;
+    };
+
+    auto &candidates = m_candidates[depth];
+    for (std::size_t r = 0; r < request.n_routes; r++) {
+        candidates[r] = r;
+    }
+    std::stable_sort(candidates.begin(), candidates.begin() + request.n_routes,
+        [&](uint8_t a, uint8_t b) {
+            return rank(request.routes[a]) < rank(request.routes[b]);
+        });
+
+    m_cursors[depth] = 0;
+    m_marks[depth] = m_trail.size();
+    m_conflicts[depth].reset();
+}
+
+/* Assigns a route to request i if it agrees with the routes assigned so
+   far, or adds the request owning the conflicting channel to conflict */
+bool Router::assign(std::size_t i, Route const &route, LinkSet &conflict) {
+    OutputPort *out = m_requests[i].link->out;
+
+    auto clash = [&](int owner) {
+        if (owner >= 0) {
+            conflict.set(owner);
+        }
+        return false;
+    };
+
+    for (std::size_t k = 0; k < route.n_channels; k++) {
+        OutputPort *driver = m_state.driver(route.channels[k]);
+        if (driver && driver != out) {
+            return clash(m_driver_owners[route.channels[k]]);
+        }
+    }
+    for (std::size_t k = 0; k < route.n_wires; k++) {
+        Wire const &w = route.wires[k];
+        if (m_wires[w.local] >= 0 && m_wires[w.local] != w.global) {
+            return clash(m_wire_owners[w.local]);
+        }
+    }
+    if (route.used_slot >= 0 && m_used[route.used_slot] >= 0
+            && m_used[route.used_slot] != route.used) {
+        return clash(m_used_owners[route.used_slot]);
+    }
+
+    int owner = static_cast<int>(i);
+    for (std::size_t k = 0; k < route.n_channels; k++) {
+        int c = route.channels[k];
+        if (!m_state.occupied(c)) {
+            m_state.set_driver(c, out);
+            m_driver_owners[c] = owner;
+            m_trail.push_back({ Change::Driver, c });
+        }
+    }
+    for (std::size_t k = 0; k < route.n_wires; k++) {
+        Wire const &w = route.wires[k];
+        if (m_wires[w.local] < 0) {
+            m_wires[w.local] = w.global;
+            m_wire_owners[w.local] = owner;
+            m_trail.push_back({ Change::Wire, w.local });
+        }
+    }
+    if (route.used_slot >= 0 && m_used[route.used_slot] < 0) {
+        m_used[route.used_slot] = route.used;
+        m_used_owners[route.used_slot] = owner;
+        m_trail.push_back({ Change::Used, route.used_slot });
+    }
+    return true;
+}
+
+void Router::undo(std::size_t mark) {
+    while (m_trail.size() > mark) {
+        TrailEntry entry = m_trail.back();
+        m_trail.pop_back();
+
+        switch (entry.change) {
+            case Change::Driver:
+                m_state.set_driver(entry.index, nullptr);
+                m_driver_owners[entry.index] = -1;
+                break;
+
+            case Change::Wire:
+                m_wires[entry.index] = -1;
+                m_wire_owners[entry.index] = -1;
+                break;
+
+            case Change::Used:
+                m_used[entry.index] = -1;
+                m_used_owners[entry.index] = -1;
+                break;
+        }
+    }
+}
+
+/* Every route of a request takes a channel of the same kind at each hop,
+   one of a pair where the route may choose the side. An output port
+   needs one channel of each such set for all its links together, and no
+   channel can be driven by two output ports. If the output ports cannot
+   all be matched to the channels they need, the search would fail, so
+   the links of output ports contending for too few channels are reported
+   right away. This ignores the rerouting of local channels and the
+   channels used by IO cells, so it does not catch every failure. */
+void Router::check() {
+    struct Demand {
+        OutputPort *out;
+        std::array<int, MaxRoutes> channels;
+        std::size_t n_channels;
+        LinkSet requests;
+    };
+
+    std::vector<Demand> demands;
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        Request const &request = m_requests[i];
+        OutputPort *out = request.link->out;
+
+        for (std::size_t k = 0; k < request.routes[0].n_channels; k++) {
+            Demand demand{ out, {}, 0, {} };
+            for (std::size_t r = 0; r < request.n_routes; r++) {
+                int c = request.routes[r].channels[k];
+                auto end = demand.channels.begin() + demand.n_channels;
+                if (std::find(demand.channels.begin(), end, c) == end) {
+                    demand.channels[demand.n_channels++] = c;
+                }
+            }
+            std::sort(demand.channels.begin(),
+                      demand.channels.begin() + demand.n_channels);
+
+            /* A set overlapping another of the port may be met by the
+               same channel, so only identical sets are merged */
+            bool merged = false;
+            for (Demand &other : demands) {
+                if (other.out != out) {
+                    continue;
+                }
+                auto begin = other.channels.begin();
+                auto end = begin + other.n_channels;
+                if (other.n_channels == demand.n_channels
+                        && std::equal(begin, end, demand.channels.begin())) {
+                    other.requests.set(i);
+                    merged = true;
+                    break;
+                }
+                for (std::size_t n = 0; n < demand.n_channels; n++) {
+                    if (std::find(begin, end, demand.channels[n]) != end) {
+                        merged = true;
+                    }
+                }
+                if (merged) {
+                    break;
+                }
+            }
+            if (!merged) {
+                demand.requests.set(i);
+                demands.push_back(demand);
+            }
+        }
+    }
+
+    /* Channels reserved before routing only take their own output port */
+    BipartiteMatching matching(demands.size(), m_channels.size());
+    for (std::size_t d = 0; d < demands.size(); d++) {
+        Demand const &demand = demands[d];
+        for (std::size_t n = 0; n < demand.n_channels; n++) {
+            int c = demand.channels[n];
+            OutputPort *driver = m_state.driver(c);
+            if (!driver || driver == demand.out) {
+                matching.add_edge(d, c);
+            }
+        }
+    }
+
+    if (matching.solve() == demands.size()) {
+        return;
+    }
+
+    std::size_t unmatched = 0;
+    while (matching.match_of_left(unmatched) != BipartiteMatching::Free) {
+        unmatched++;
+    }
+
+    std::vector<bool> lefts, rights;
+    matching.deficient_set(unmatched, lefts, rights);
+
+    LinkSet links;
+    std::vector<OutputPort *> ports;
+    for (std::size_t d = 0; d < demands.size(); d++) {
+        if (!lefts[d]) {
+            continue;
+        }
+        links |= demands[d].requests;
+        if (std::find(ports.begin(), ports.end(), demands[d].out)
+                == ports.end()) {
+            ports.push_back(demands[d].out);
+        }
+    }
+
+    std::stringstream ss;
+    print_links(ss, links);
+    std::size_t n_channels = std::count(rights.begin(), rights.end(), true);
+    ss << std::endl << "(" << ports.size() << " output ports for "
+       << n_channels << " channels";
+    char const *sep = ": ";
+    for (std::size_t c = 0; c < m_channels.size(); c++) {
+        if (rights[c]) {
+            ss << sep << *m_channels[c];
+            sep = ", ";
+        }
+    }
+    ss << ")";
+    throw DesignError(ss.str());
+}
+
+/* Allocates the channels of the chosen routes */
+void Router::apply() {
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        Request &request = m_requests[i];
+        Route const &route = request.routes[m_choices[i]];
+        PortLink &link = *request.link;
+
+        for (std::size_t k = 0; k < route.n_channels; k++) {
+            m_channels[route.channels[k]]->allocate(link);
+        }
+
+        for (std::size_t k = 0; k < route.n_wires; k++) {
+            Channel &local = *m_channels[route.wires[k].local];
+            Channel &global = *m_channels[route.wires[k].global];
+            if (local.type == Channel::Type::LocalInput) {
+                local.set_local_input_source(global);
+            } else {
+                local.set_local_output_dest(global);
+            }
+        }
+
+        if (route.used_slot >= 0) {
+            IOCell &cell = m_chip.io_cell(route.used_slot / 2 + 1);
+            CabColumn column = static_cast<CabColumn>(route.used_slot % 2);
+            cell.set_used_channel(column, *m_channels[route.used]);
+        }
+
+        report_count(Counter::LinksRouted);
+
+        if (std::ostream *log = m_chip.log()) {
+            *log << link << std::endl;
+        }
+    }
+}
+
+/* Shrinks the unroutable links to a minimal set by dropping every link
+   without which the rest still cannot be routed */
+void Router::fail() {
+    LinkSet core;
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        core.set(i);
+    }
+
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        core.reset(i);
+        if (solve(core)) {
+            undo(0);
+            core.set(i);
+        }
+    }
+
+    std::stringstream ss;
+    print_links(ss, core);
+    throw DesignError(ss.str());
+}
+
+/* Starts the error for links that cannot be routed with a list of them */
+void Router::print_links(std::ostream &os, LinkSet const &links) const {
+    os << "could not route the links:";
+    for (std::size_t i = 0; i < m_requests.size(); i++) {
+        if (links[i]) {
+            PortLink const &link = *m_requests[i].link;
+            os << std::endl << "    " << *link.out << " -> " << *link.in;
+        }
+    }
+}
@@ -0,0 +1,36 @@
+#include "routing-state.hpp"
+#include "error.hpp"
+#include <algorithm>
+
+RoutingState::RoutingState()
+        : m_occupied{}, m_drivers{}, m_ports{}, m_n_ports{1} {}
+
+void RoutingState::set_driver(std::size_t channel, OutputPort *out) {
+    m_drivers[channel] = port_id(out);
+    m_occupied[channel] = out != nullptr;
+}
+
+void RoutingState::clear() {
+    m_occupied.reset();
+    m_drivers.fill(0);
+    std::fill(m_ports.begin(), m_ports.begin() + m_n_ports, nullptr);
+    m_n_ports = 1;
+}
+
+uint8_t RoutingState::port_id(OutputPort *out) {
+    if (!out) {
+        return 0;
+    }
+
+    auto end = m_ports.begin() + m_n_ports;
+    auto iter = std::find(m_ports.begin() + 1, end, out);
+    if (iter != end) {
+        return iter - m_ports.begin();
+    }
+
+    if (m_n_ports == m_ports.size()) {
+        throw DesignError("too many output ports to route");
+    }
+    m_ports[m_n_ports] = out;
+    return m_n_ports++;
+}
@@ -0,0 +1,256 @@
+#include "server.hpp"
+#include "obc.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <csignal>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+static volatile std::sig_atomic_t stop_requested = 0;
+
+static void request_stop(int) {
+    stop_requested = 1;
+}
+
+static void install_signal_handlers() {
+    struct sigaction action = {};
+    action.sa_handler = request_stop;
+    sigemptyset(&action.sa_mask);
+    action.sa_flags = 0; /* No SA_RESTART: blocking calls return EINTR */
+
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+}
+
+[[noreturn]] static void system_error(std::string const &what) {
+    std::stringstream ss;
+    ss << what << ": " << std::strerror(errno);
+    throw std::runtime_error(ss.str());
+}
+
+/* Returns false if the connection was closed or interrupted. */
+static bool read_exact(int fd, void *buf, std::size_t n) {
+    uint8_t *p = static_cast<uint8_t *>(buf);
+    while (n > 0) {
+        ssize_t res = read(fd, p, n);
+        if (res == 0) {
+            return false;
+        }
+        if (res < 0) {
+            if (errno == EINTR && !stop_requested) {
+                continue;
+            }
+            return false;
+        }
+        p += res;
+        n -= res;
+    }
+    return true;
+}
+
+static bool write_exact(int fd, void const *buf, std::size_t n) {
+    uint8_t const *p = static_cast<uint8_t const *>(buf);
+    while (n > 0) {
+        ssize_t res = write(fd, p, n);
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return false;
+        }
+        p += res;
+        n -= res;
+    }
+    return true;
+}
+
+static bool write_reply(int fd, uint8_t status,
+                        uint8_t const *payload, std::size_t size) {
+    uint8_t header[5] = {
+        status,
+        static_cast<uint8_t>(size >> 24),
+        static_cast<uint8_t>(size >> 16),
+        static_cast<uint8_t>(size >> 8),
+        static_cast<uint8_t>(size),
+    };
+
+    return write_exact(fd, header, sizeof(header))
+        && write_exact(fd, payload, size);
+}
+
+static bool write_reply(int fd, uint8_t status, std::string const &text) {
+    return write_reply(fd, status,
+                       reinterpret_cast<uint8_t const *>(text.data()),
+                       text.size());
+}
+
+LatencyStats::LatencyStats()
+        : m_requests{}, m_failed{},
+          m_total{}, m_min{std::chrono::nanoseconds::max()},
+          m_max{}, m_last{} {}
+
+void LatencyStats::record(std::chrono::nanoseconds latency, bool ok) {
+    m_requests++;
+    if (!ok) {
+        m_failed++;
+    }
+
+    m_total += latency;
+    m_min = std::min(m_min, latency);
+    m_max = std::max(m_max, latency);
+    m_last = latency;
+}
+
+std::ostream &operator <<(std::ostream &os, LatencyStats const &stats) {
+    using us = std::chrono::duration<double, std::micro>;
+
+    os << stats.m_requests << " requests (" << stats.m_failed << " failed)";
+    if (stats.m_requests == 0) {
+        return os;
+    }
+
+    double mean = us(stats.m_total).count() / stats.m_requests;
+    os << ", latency [us] last " << us(stats.m_last).count()
+       << " min " << us(stats.m_min).count()
+       << " mean " << mean
+       << " max " << us(stats.m_max).count();
+    return os;
+}
+
+Server::Server(std::string const &socket_path, bool verbose)
+        : m_socket_path{socket_path}, m_verbose{verbose}, m_fd{-1},
+          m_pool{2}, m_stats{} {}
+
+Server::~Server() {
+    if (m_fd >= 0) {
+        close(m_fd);
+        unlink(m_socket_path.c_str());
+    }
+}
+
+void Server::run() {
+    install_signal_handlers();
+    open_socket();
+
+    std::cerr << "Listening on " << m_socket_path << std::endl;
+
+    while (!stop_requested) {
+        int fd = accept(m_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            system_error("accept");
+        }
+
+        serve_connection(fd);
+        close(fd);
+    }
+
+    std::cerr << "Shutting down: " << m_stats << std::endl;
+}
+
+void Server::open_socket() {
+    sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+
+    if (m_socket_path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + m_socket_path);
+    }
+    std::strncpy(addr.sun_path, m_socket_path.c_str(),
+                 sizeof(addr.sun_path) - 1);
+
+    m_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (m_fd < 0) {
+        system_error("socket");
+    }
+
+    /* A stale socket of a previous daemon would make bind() fail */
+    unlink(m_socket_path.c_str());
+
+    if (bind(m_fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) < 0) {
+        system_error("bind " + m_socket_path);
+    }
+
+    if (listen(m_fd, 16) < 0) {
+        system_error("listen");
+    }
+}
+
+void Server::serve_connection(int fd) {
+    while (!stop_requested && handle_request(fd)) {
+        /* Chips are built between requests rather than during them */
+        m_pool.replenish();
+    }
+}
+
+bool Server::handle_request(int fd) {
+    uint8_t header[5];
+    if (!read_exact(fd, header, sizeof(header))) {
+        return false;
+    }
+
+    uint32_t size = (static_cast<uint32_t>(header[1]) << 24)
+                  | (static_cast<uint32_t>(header[2]) << 16)
+                  | (static_cast<uint32_t>(header[3]) << 8)
+                  | static_cast<uint32_t>(header[4]);
+
+    if (size > protocol::MaxPayloadSize) {
+        write_reply(fd, protocol::Error, "payload too large");
+        return false;
+    }
+
+    std::string payload(size, '\0');
+    if (!read_exact(fd, payload.data(), size)) {
+        return false;
+    }
+
+    switch (header[0]) {
+        case protocol::Compile: {
+            auto start = std::chrono::steady_clock::now();
+
+            std::vector<uint8_t> reply;
+            bool ok = compile(payload, reply);
+
+            auto latency = std::chrono::steady_clock::now() - start;
+            m_stats.record(latency, ok);
+
+            if (m_verbose) {
+                std::cerr << "Request " << m_stats.requests() << ": "
+                          << m_stats << std::endl;
+            }
+
+            return write_reply(fd, ok ? protocol::Ok : protocol::Error,
+                               reply.data(), reply.size());
+        }
+
+        case protocol::Stats: {
+            std::stringstream ss;
+            ss << m_stats;
+            return write_reply(fd, protocol::Ok, ss.str());
+        }
+    }
+
+    std::stringstream ss;
+    ss << "unknown command: " << static_cast<int>(header[0]);
+    return write_reply(fd, protocol::Error, ss.str());
+}
+
+bool Server::compile(std::string const &text, std::vector<uint8_t> &reply) {
+    CompileOptions options;
+    options.name = "<request>";
+
+    try {
+        reply = compile_design(text, options, m_pool).bytestream;
+    } catch (std::exception const &e) {
+        std::string what = e.what();
+        reply.assign(what.begin(), what.end());
+        return false;
+    }
+
+    return true;
+}
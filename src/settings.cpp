@@ -1,5 +1,6 @@
 #include "settings.hpp"
 
 Args args = {
-    false, false, false, false, "", ""
+    false, false, false, false, false, false, false, false,
+    "", "", "", "", "", "", "", 0, 0, {}
 };
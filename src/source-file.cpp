@@ -0,0 +1,119 @@
+#include "source-file.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+[[noreturn]] static void open_error(std::string const &filename) {
+    std::stringstream ss;
+    ss << "Could not open file: " << filename << ": " << std::strerror(errno);
+    throw std::runtime_error(ss.str());
+}
+
+static void read_all(int fd, std::string const &filename, 
+                     std::string &buffer) {
+    char chunk[64 * 1024];
+    while (true) {
+        ssize_t res = read(fd, chunk, sizeof(chunk));
+        if (res == 0) {
+            return;
+        }
+        if (res < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            open_error(filename);
+        }
+        buffer.append(chunk, res);
+    }
+}
+
+SourceFile::SourceFile()
+        : m_map{}, m_map_size{}, m_buffer{} {}
+
+SourceFile::~SourceFile() {
+    release();
+}
+
+SourceFile::SourceFile(SourceFile &&other)
+        : m_map{other.m_map}, m_map_size{other.m_map_size}, 
+          m_buffer{std::move(other.m_buffer)} {
+    other.m_map = nullptr;
+    other.m_map_size = 0;
+}
+
+SourceFile &SourceFile::operator=(SourceFile &&other) {
+    if (this != &other) {
+        release();
+        m_map = other.m_map;
+        m_map_size = other.m_map_size;
+        m_buffer = std::move(other.m_buffer);
+        other.m_map = nullptr;
+        other.m_map_size = 0;
+    }
+    return *this;
+}
+
+SourceFile SourceFile::Open(std::string const &filename) {
+    SourceFile file;
+
+    if (filename == "-") {
+        read_all(STDIN_FILENO, filename, file.m_buffer);
+        return file;
+    }
+
+    int fd = open(filename.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        open_error(filename);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0) {
+        void *map = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED) {
+            /* The lexer reads front to back */
+            madvise(map, st.st_size, MADV_SEQUENTIAL);
+            file.m_map = map;
+            file.m_map_size = st.st_size;
+        }
+    }
+
+    if (!file.m_map) {
+        try {
+            read_all(fd, filename, file.m_buffer);
+        } catch (...) {
+            close(fd);
+            throw;
+        }
+    }
+
+    /* A mapping stays valid after closing its file */
+    close(fd);
+    return file;
+}
+
+SourceFile SourceFile::FromString(std::string text) {
+    SourceFile file;
+    file.m_buffer = std::move(text);
+    return file;
+}
+
+std::string_view SourceFile::text() const {
+    if (m_map) {
+        return std::string_view(static_cast<char const *>(m_map), 
+                                m_map_size);
+    }
+    return m_buffer;
+}
+
+void SourceFile::release() {
+    if (m_map) {
+        munmap(m_map, m_map_size);
+        m_map = nullptr;
+        m_map_size = 0;
+    }
+}
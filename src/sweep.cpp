@@ -0,0 +1,104 @@
+#include "sweep.hpp"
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "thread-pool.hpp"
+#include "time-report.hpp"
+#include <sstream>
+#include <stdexcept>
+#include <memory>
+#include <vector>
+#include <chrono>
+#include <cmath>
+
+std::size_t SweepRange::size() const {
+    /* Tolerate rounding in (last - first) / step, e.g. 0.01:0.5:0.01 */
+    return std::floor((last - first) / step + 1e-9) + 1;
+}
+
+SweepRange parse_sweep_range(std::string const &spec) {
+    std::size_t equals = spec.find('=');
+    std::string const error = "expected '<name>=<first>:<last>:<step>': ";
+
+    if (equals == std::string::npos || equals == 0) {
+        throw std::runtime_error(error + spec);
+    }
+
+    SweepRange range;
+    range.constant = spec.substr(0, equals);
+
+    std::stringstream ss(spec.substr(equals + 1));
+    char sep1 = 0, sep2 = 0;
+    std::string trailing;
+    if (!(ss >> range.first >> sep1 >> range.last >> sep2 >> range.step) 
+        || sep1 != ':' || sep2 != ':' || ss >> trailing) {
+        throw std::runtime_error(error + spec);
+    }
+
+    if (!(range.step > 0) || range.last < range.first) {
+        throw std::runtime_error("empty sweep range: " + spec);
+    }
+
+    return range;
+}
+
+/* Chip and parse state of one worker thread */
+struct SweepWorker {
+    Lexer lexer;
+    Parser parser;
+    std::unique_ptr<AnalogChip> chip;
+    CompileResult result;
+    bool compiled = false;
+};
+
+SweepResult run_sweep(std::string_view source, CompileOptions const &options,
+                      SweepRange const &range, std::size_t n_threads,
+                      std::function<void(std::size_t, AnalogChip &, 
+                                         CompileResult const &)> const &emit) {
+    std::size_t n_points = range.size();
+    std::vector<SweepWorker> workers(n_threads);
+    SweepResult result{ std::vector<std::string>(n_points), 0, 0.0 };
+
+    /* Structural problems affect every point, so they fail the sweep */
+    workers[0].lexer.open_view(source, options.name);
+    workers[0].chip = workers[0].parser.parse(workers[0].lexer);
+    workers[0].parser.check_sweepable(range.constant);
+
+    auto start = std::chrono::steady_clock::now();
+    TimeReport *report = TimeReport::current();
+
+    parallel_for(n_points, n_threads, [&](std::size_t i, std::size_t w) {
+        ScopedTimeReport scope(report);
+        SweepWorker &worker = workers[w];
+
+        try {
+            if (!worker.chip) {
+                worker.lexer.open_view(source, options.name);
+                worker.chip = worker.parser.parse(worker.lexer);
+            }
+
+            worker.parser.rebind(range.constant, range.value(i));
+
+            /* A failed point leaves the chip to be compiled from scratch */
+            if (worker.compiled) {
+                recompile_chip(*worker.chip, worker.result, options);
+            } else {
+                worker.result = compile_chip(*worker.chip, options);
+                worker.compiled = true;
+            }
+
+            emit(i, *worker.chip, worker.result);
+        } catch (std::exception const &e) {
+            result.errors[i] = e.what();
+        }
+    });
+
+    std::chrono::duration<double> elapsed = 
+            std::chrono::steady_clock::now() - start;
+    result.seconds = elapsed.count();
+
+    for (std::string const &error : result.errors) {
+        result.n_failed += !error.empty();
+    }
+
+    return result;
+}
@@ -0,0 +1,51 @@
+#include "thread-pool.hpp"
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <exception>
+#include <algorithm>
+
+std::size_t default_n_threads() {
+    return std::max(1U, std::thread::hardware_concurrency());
+}
+
+void parallel_for(std::size_t n, std::size_t n_threads,
+                  std::function<void(std::size_t, std::size_t)> const &job) {
+    n_threads = std::clamp<std::size_t>(n_threads, 1, std::max<std::size_t>(n, 1));
+
+    std::atomic<std::size_t> next{0};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto work = [&](std::size_t worker) {
+        for (std::size_t i = next++; i < n; i = next++) {
+            try {
+                job(i, worker);
+            } catch (...) {
+                std::lock_guard<std::mutex> lock(error_mutex);
+                if (!error) {
+                    error = std::current_exception();
+                }
+                next = n;
+            }
+        }
+    };
+
+    if (n_threads == 1) {
+        work(0);
+    } else {
+        std::vector<std::thread> threads;
+        threads.reserve(n_threads);
+        for (std::size_t worker = 0; worker < n_threads; worker++) {
+            threads.emplace_back(work, worker);
+        }
+        for (std::thread &thread : threads) {
+            thread.join();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
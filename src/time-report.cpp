@@ -0,0 +1,90 @@
+#include "time-report.hpp"
+#include <iomanip>
+
+thread_local TimeReport *TimeReport::t_current = nullptr;
+
+char const *to_string(Phase phase) {
+    switch (phase) {
+        case Phase::Lex:                return "lex";
+        case Phase::Parse:              return "parse";
+        case Phase::LoadDesignCache:    return "load_design_cache";
+        case Phase::ClaimComponents:    return "claim_components";
+        case Phase::Place:              return "place";
+        case Phase::FinalizeComparator: return "finalize_comparator";
+        case Phase::Route:              return "route";
+        case Phase::CompileIORouting:   return "compile_io_routing";
+        case Phase::CabFinalizeModules: return "cab_finalize_modules";
+        case Phase::CabCompile:         return "cab_compile";
+        case Phase::CompileClocks:      return "compile_clocks";
+        case Phase::ToDataBytestream:   return "to_data_bytestream";
+        case Phase::WriteOutput:        return "write_output";
+        case Phase::NPhases:            break;
+    }
+    return "?";
+}
+
+char const *to_string(Counter counter) {
+    switch (counter) {
+        case Counter::TokensLexed:          return "tokens_lexed";
+        case Counter::LinksRouted:          return "links_routed";
+        case Counter::ChannelsAllocated:    return "channels_allocated";
+        case Counter::CapacitorsProgrammed: return "capacitors_programmed";
+        case Counter::SectionsEmitted:      return "sections_emitted";
+        case Counter::NCounters:            break;
+    }
+    return "?";
+}
+
+TimeReport::TimeReport()
+        : m_calls{}, m_nanoseconds{}, m_counters{} {}
+
+void TimeReport::add_time(Phase phase, std::chrono::nanoseconds time) {
+    std::size_t i = static_cast<std::size_t>(phase);
+    m_calls[i].fetch_add(1, std::memory_order_relaxed);
+    m_nanoseconds[i].fetch_add(time.count(), std::memory_order_relaxed);
+}
+
+void TimeReport::add_count(Counter counter, uint64_t n) {
+    std::size_t i = static_cast<std::size_t>(counter);
+    m_counters[i].fetch_add(n, std::memory_order_relaxed);
+}
+
+void TimeReport::write_json(std::ostream &os) const {
+    os << "{\n  \"phases\": {";
+    for (std::size_t i = 0; i < NPhases; i++) {
+        os << (i ? ",\n" : "\n") << "    \"" 
+           << to_string(static_cast<Phase>(i)) << "\": { \"calls\": " 
+           << m_calls[i] << ", \"seconds\": " 
+           << m_nanoseconds[i] * 1e-9 << " }";
+    }
+    os << "\n  },\n  \"counters\": {";
+    for (std::size_t i = 0; i < NCounters; i++) {
+        os << (i ? ",\n" : "\n") << "    \"" 
+           << to_string(static_cast<Counter>(i)) << "\": " 
+           << m_counters[i];
+    }
+    os << "\n  }\n}" << std::endl;
+}
+
+std::ostream &operator <<(std::ostream &os, TimeReport const &report) {
+    os << std::left << std::setw(24) << "phase" << std::right 
+       << std::setw(10) << "calls" << std::setw(14) << "time [ms]" 
+       << std::endl;
+
+    for (std::size_t i = 0; i < TimeReport::NPhases; i++) {
+        os << std::left << std::setw(24) << to_string(static_cast<Phase>(i))
+           << std::right << std::setw(10) << report.m_calls[i] 
+           << std::setw(14) << std::fixed << std::setprecision(3) 
+           << report.m_nanoseconds[i] * 1e-6 << std::endl;
+    }
+
+    os << std::defaultfloat;
+
+    for (std::size_t i = 0; i < TimeReport::NCounters; i++) {
+        os << std::left << std::setw(24) 
+           << to_string(static_cast<Counter>(i)) << std::right 
+           << std::setw(10) << report.m_counters[i] << std::endl;
+    }
+
+    return os;
+}
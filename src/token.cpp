@@ -1,39 +1,7 @@
 #include "token.hpp"
+#include "error.hpp"
 #include <sstream>
-
-char const *to_string(TokenType type) {
-    switch (type) {
-        case TokenType::None:           return "(none)";
-        case TokenType::Identifier:     return "(identifier)";
-        case TokenType::Number:         return "(number)";
-        case TokenType::EndOfFile:      return "(end-of-file)";
-        case TokenType::Let:            return "let";
-        case TokenType::Chip:           return "chip";
-        case TokenType::With:           return "with";
-        case TokenType::Clocks:         return "clocks";
-        case TokenType::As:             return "as";
-        case TokenType::Cab:            return "cab";
-        case TokenType::Cmp:            return "cmp";
-        case TokenType::True:           return "true";
-        case TokenType::False:          return "false";
-        case TokenType::Arrow:          return "->";
-        case TokenType::Plus:           return "+";
-        case TokenType::Minus:          return "-";
-        case TokenType::Asterisk:       return "*";
-        case TokenType::Slash:          return "/";
-        case TokenType::Equals:         return "=";
-        case TokenType::LBracket:       return "(";
-        case TokenType::RBracket:       return ")";
-        case TokenType::LBrace:         return "{";
-        case TokenType::RBrace:         return "}";
-        case TokenType::LSqBracket:     return "[";
-        case TokenType::RSqBracket:     return "]";
-        case TokenType::Colon:          return ":";
-        case TokenType::Comma:          return ",";
-        case TokenType::Semicolon:      return ";";
-        default:                        return "";
-    }
-}
+#include <algorithm>
 
 std::ostream &operator <<(std::ostream &os, TokenType type) {
     os << to_string(type);
@@ -45,13 +13,58 @@ std::ostream &operator <<(std::ostream &os, TextPosition const &pos) {
     return os;
 }
 
-void Token::error(std::string const &s) {
-    std::stringstream ss;
-    ss << pos() << ": " << s;
-    throw std::runtime_error(ss.str());
+SourceText::SourceText()
+        : m_text{}, m_name{}, m_lines_mutex{}, m_line_starts{} {}
+
+SourceText::SourceText(std::string_view text, std::string const &name)
+        : m_text{text}, m_name{name}, m_lines_mutex{}, m_line_starts{} {}
+
+void SourceText::reset(std::string_view text, std::string const &name) {
+    std::lock_guard<std::mutex> lock(m_lines_mutex);
+    m_text = text;
+    m_name = name;
+    m_line_starts.clear();
 }
 
-std::ostream &operator <<(std::ostream &os, Token const &token) {
-    os << token.m_pos << " <" << token.m_type << "> '" << token.m_lexeme << "'";
-    return os;
+std::vector<uint32_t> const &SourceText::line_starts() const {
+    if (m_line_starts.empty()) {
+        m_line_starts.push_back(0);
+        for (std::size_t i = 0; i < m_text.size(); i++) {
+            if (m_text[i] == '\n') {
+                m_line_starts.push_back(i + 1);
+            }
+        }
+    }
+    return m_line_starts;
+}
+
+TextPosition SourceText::position(std::size_t offset) const {
+    std::lock_guard<std::mutex> lock(m_lines_mutex);
+    auto const &starts = line_starts();
+
+    auto next_line = std::upper_bound(starts.begin(), starts.end(), offset);
+    std::size_t line = next_line - starts.begin();
+    std::size_t col = offset - *(next_line - 1) + 1;
+
+    return TextPosition(m_name, line, col);
+}
+
+std::size_t SourceText::offset(std::size_t line, std::size_t col) const {
+    std::lock_guard<std::mutex> lock(m_lines_mutex);
+    auto const &starts = line_starts();
+
+    if (line < 1 || line > starts.size()) {
+        return line < 1 ? 0 : m_text.size();
+    }
+
+    std::size_t begin = starts[line - 1];
+    std::size_t end = line < starts.size() ? starts[line] - 1 
+                                           : m_text.size();
+    return std::min(begin + std::max<std::size_t>(col, 1) - 1, end);
+}
+
+void SourceText::error(std::size_t offset, std::string const &s) const {
+    std::stringstream ss;
+    ss << position(offset) << ": " << s;
+    throw SourceError(ss.str(), offset, s);
 }
@@ -1,9 +1,20 @@
 #include "util.hpp"
-#include "settings.hpp"
 #include <limits>
 #include <cmath>
 #include <algorithm>
 #include <iostream>
+#include <numeric>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define OBC_HAVE_AVX2_DISPATCH 1
+#endif
+
+/* The numerator is truncated: clamped first, so that the conversion is 
+   defined for any value */
+static double truncate_numerator(double num) {
+    return std::trunc(std::clamp(num, 0.0, 255.0));
+}
 
 void compute_ratios(std::vector<double> const &values,
                     std::vector<uint8_t> &nums, uint8_t den) {
@@ -12,45 +23,244 @@ void compute_ratios(std::vector<double> const &values,
         double v = values[i];
         double num = v * den;
 
-        nums.push_back(std::clamp(static_cast<int>(num), 0, 255));
+        nums.push_back(truncate_numerator(num));
     }
 }
 
-void approximate_ratios(std::vector<double> const &values, 
-                        std::vector<uint8_t> &nums, uint8_t &den) {
+/* Fills deltas[d] with the summed absolute error of all values realized 
+   with denominator d, for d in [1, 255]. */
+using RatioDeltas = double[256];
+using ComputeRatioDeltas = void (*)(double const *, std::size_t, 
+                                    RatioDeltas &);
+
+static void compute_ratio_deltas_scalar(double const *values, std::size_t n,
+                                        RatioDeltas &deltas) {
+    for (int d = 1; d <= 255; d++) {
+        double delta = 0;
+        for (std::size_t i = 0; i < n; i++) {
+            double num = truncate_numerator(values[i] * d);
+            delta += std::abs(num / d - values[i]);
+        }
+        deltas[d] = delta;
+    }
+}
+
+#ifdef OBC_HAVE_AVX2_DISPATCH
+/* Four denominators per vector. Every lane performs the same sequence of 
+   IEEE operations as the scalar version, so the deltas are bit-identical 
+   (fused multiply-add is not enabled for this function). */
+__attribute__((target("avx2")))
+static void compute_ratio_deltas_avx2(double const *values, std::size_t n,
+                                      RatioDeltas &deltas) {
+    __m256d const zero = _mm256_setzero_pd();
+    __m256d const max = _mm256_set1_pd(255.0);
+    __m256d const sign = _mm256_set1_pd(-0.0);
+    __m256d const step = _mm256_set1_pd(4.0);
+
+    /* Lanes hold d = 0..3 in the first iteration; d = 0 is never read */
+    __m256d d = _mm256_setr_pd(0.0, 1.0, 2.0, 3.0);
+
+    for (int base = 0; base < 256; base += 4) {
+        __m256d delta = zero;
+        for (std::size_t i = 0; i < n; i++) {
+            __m256d v = _mm256_set1_pd(values[i]);
+            __m256d num = _mm256_min_pd(_mm256_max_pd(_mm256_mul_pd(v, d), 
+                                                      zero), max);
+            num = _mm256_round_pd(num, _MM_FROUND_TO_ZERO 
+                                       | _MM_FROUND_NO_EXC);
+            __m256d err = _mm256_sub_pd(_mm256_div_pd(num, d), v);
+            delta = _mm256_add_pd(delta, _mm256_andnot_pd(sign, err));
+        }
+        _mm256_storeu_pd(&deltas[base], delta);
+        d = _mm256_add_pd(d, step);
+    }
+}
+#endif
+
+static ComputeRatioDeltas select_compute_ratio_deltas() {
+#ifdef OBC_HAVE_AVX2_DISPATCH
+    if (__builtin_cpu_supports("avx2")) {
+        return compute_ratio_deltas_avx2;
+    }
+#endif
+    return compute_ratio_deltas_scalar;
+}
+
+struct Fraction {
+    uint8_t num;
+    uint8_t den;
+};
+
+/* All reduced fractions with 8-bit numerator and denominator in 
+   ascending order (the Farey sequence of order 255, extended to 255/1), 
+   with their values as computed by the search kept alongside */
+struct FractionTable {
+    static constexpr std::size_t BlockSize = 64;
+
+    std::vector<Fraction> fractions;
+    std::vector<double> values;
+
+    /* First value of every block, so that a lookup only touches a few 
+       cache lines of the (~300 KiB) values */
+    std::vector<double> block_values;
+
+    /* Index of the first fraction larger than value */
+    std::size_t upper_bound(double value) const;
+};
+
+std::size_t FractionTable::upper_bound(double value) const {
+    std::size_t block = std::upper_bound(block_values.begin(), 
+                                         block_values.end(), value) 
+                      - block_values.begin();
+    if (block == 0) {
+        return 0;
+    }
+
+    auto begin = values.begin() + (block - 1) * BlockSize;
+    auto end = values.begin() + std::min(block * BlockSize, values.size());
+    return std::upper_bound(begin, end, value) - values.begin();
+}
+
+static FractionTable build_fraction_table() {
+    FractionTable table;
+
+    for (int den = 1; den <= 255; den++) {
+        for (int num = 0; num <= 255; num++) {
+            if (std::gcd(num, den) == 1) {
+                table.fractions.push_back({ static_cast<uint8_t>(num), 
+                                            static_cast<uint8_t>(den) });
+            }
+        }
+    }
+
+    std::sort(table.fractions.begin(), table.fractions.end(), 
+              [](Fraction const &a, Fraction const &b) {
+        return a.num * b.den < b.num * a.den;
+    });
+
+    for (Fraction const &f : table.fractions) {
+        table.values.push_back(static_cast<double>(f.num) / f.den);
+    }
+
+    for (std::size_t i = 0; i < table.values.size(); i += table.BlockSize) {
+        table.block_values.push_back(table.values[i]);
+    }
+
+    return table;
+}
+
+/* Returns the denominator that approximate_ratios selects for a single 
+   finite value. The truncated numerator makes the best ratio the largest 
+   fraction below value, or the smallest one above it when value * den 
+   rounds up to an integer. Both are next to the binary search position; 
+   the ones beside them cover rounding in the search itself. Scoring all 
+   multiples of their denominators exactly like the full search keeps 
+   its tie-breaking (the largest denominator wins). */
+static uint8_t lookup_denominator(double value) {
+    static FractionTable const table = build_fraction_table();
+    std::vector<Fraction> const &fractions = table.fractions;
+
+    std::size_t above = table.upper_bound(value);
+
     uint8_t best_den = 0;
     double best_den_delta = std::numeric_limits<double>::infinity();
-    
-    for (uint8_t d = 255; d > 0; d--) {
-        compute_ratios(values, nums, d);
 
-        double delta = 0;
-        for (std::size_t i = 0; i < values.size(); i++) {
-            delta += std::abs(static_cast<double>(nums[i]) / d - values[i]);
+    std::size_t first = above < 2 ? 0 : above - 2;
+    std::size_t last = std::min(above + 1, fractions.size() - 1);
+
+    for (std::size_t i = first; i <= last; i++) {
+        for (int d = fractions[i].den; d <= 255; d += fractions[i].den) {
+            double num = truncate_numerator(value * d);
+            double delta = std::abs(num / d - value);
+
+            if (delta < best_den_delta 
+                || (delta == best_den_delta && d > best_den)) {
+                best_den = d;
+                best_den_delta = delta;
+            }
         }
+    }
 
-        if (delta < best_den_delta) {
-            best_den = d;
-            best_den_delta = delta;
+    return best_den;
+}
+
+/* Index of the only non-zero value, values.size() if all are zero, or 
+   -1 if there are several or any is not finite. */
+static std::ptrdiff_t single_value_index(std::vector<double> const &values) {
+    std::ptrdiff_t index = values.size();
+
+    for (std::size_t i = 0; i < values.size(); i++) {
+        if (!std::isfinite(values[i])) {
+            return -1;
+        }
+        if (values[i] != 0.0) {
+            if (index != static_cast<std::ptrdiff_t>(values.size())) {
+                return -1;
+            }
+            index = i;
+        }
+    }
+
+    return index;
+}
+
+void approximate_ratios(std::vector<double> const &values, 
+                        std::vector<uint8_t> &nums, uint8_t &den,
+                        std::ostream *log) {
+    static ComputeRatioDeltas const compute_ratio_deltas = 
+            select_compute_ratio_deltas();
+
+    uint8_t best_den = 0;
+    std::ptrdiff_t single = single_value_index(values);
+
+    /* Zero values add nothing to the error of any denominator, so a 
+       single gain (as padded by SumInv and Integrator) is looked up */
+    if (single >= 0) {
+        double value = static_cast<std::size_t>(single) < values.size() 
+                     ? values[single] : 0.0;
+        best_den = lookup_denominator(value);
+    } else {
+        RatioDeltas deltas;
+        compute_ratio_deltas(values.data(), values.size(), deltas);
+
+        double best_den_delta = std::numeric_limits<double>::infinity();
+    
+        for (uint8_t d = 255; d > 0; d--) {
+            if (deltas[d] < best_den_delta) {
+                best_den = d;
+                best_den_delta = deltas[d];
+            }
         }
     }
 
     compute_ratios(values, nums, best_den);
     den = best_den;
 
-    if (args.verbose) {
+    if (log) {
         for (std::size_t i = 0; i < values.size(); i++) {
             double f = static_cast<double>(nums[i]) / den;
-            std::cerr << values[i] << " realized as " << f << std::endl;
+            *log << values[i] << " realized as " << f << std::endl;
         }
     }
 }
 
-void approximate_ratio(double value, uint8_t &num, uint8_t &den) {
-    std::vector<double> values = { value };
-    std::vector<uint8_t> nums;
-    approximate_ratios(values, nums, den);
-    num = nums.front();
+void approximate_ratio(double value, uint8_t &num, uint8_t &den,
+                       std::ostream *log) {
+    if (!std::isfinite(value)) {
+        std::vector<double> values = { value };
+        std::vector<uint8_t> nums;
+        approximate_ratios(values, nums, den, log);
+        num = nums.front();
+        return;
+    }
+
+    den = lookup_denominator(value);
+    num = truncate_numerator(value * den);
+
+    if (log) {
+        double f = static_cast<double>(num) / den;
+        *log << value << " realized as " << f << std::endl;
+    }
 }
 
 int round_and_clamp(double number, int lower, int upper) {
@@ -0,0 +1,70 @@
+/* Delta bytestreams (--delta-from): the delta from the golden image of
+   tests/heat.acf to the design in tests/delta/heat.acf, which changes two
+   let constants, matches the golden tests/delta/heat.delta, and applying
+   it to the previous image gives the image of a full compile. Run from
+   the repository root. */
+
+#include "harness.hpp"
+#include "analog-chip.hpp"
+#include "shadow-sram.hpp"
+#include "obc.hpp"
+#include <sstream>
+
+static constexpr std::size_t HeaderSize = 7;
+
+static uint8_t at(ShadowSRam const &ssram, std::size_t i) {
+    return ssram.get(i / 0x20, i % 0x20).value();
+}
+
+/* Index of the first byte in which the images differ, or their size */
+static std::size_t mismatch(ShadowSRam const &a, ShadowSRam const &b) {
+    std::size_t i = 0;
+    while (i < a.size() && at(a, i) == at(b, i)) {
+        i++;
+    }
+    return i;
+}
+
+static void load_image(ShadowSRam &ssram, std::vector<uint8_t> const &image) {
+    expect(image.size() == ssram.size(), "not a raw image");
+    for (std::size_t i = 0; i < image.size(); i++) {
+        ssram.set(i / 0x20, i % 0x20, image[i]);
+    }
+}
+
+static void check_heat() {
+    std::vector<uint8_t> image = read_values("tests/heat.out");
+    ShadowSRam previous;
+    load_image(previous, image);
+
+    auto chip = parse_file("tests/delta/heat.acf");
+    CompileResult full = compile_chip(*chip);
+
+    std::vector<uint8_t> delta = delta_bytestream(*chip, previous,
+                                                  full.ssram);
+    expect(delta == read_values("tests/delta/heat.delta"),
+           "delta differs from tests/delta/heat.delta");
+    expect(delta.size() < full.bytestream.size(),
+           "delta is no shorter than the full bytestream");
+
+    ShadowSRam updated;
+    load_image(updated, image);
+    std::size_t n = updated.apply_data_bytestream(
+            delta.data() + HeaderSize, delta.size() - HeaderSize);
+    expect(n == delta.size() - HeaderSize, "delta not consumed entirely");
+
+    std::size_t i = mismatch(updated, full.ssram);
+    if (i < updated.size()) {
+        std::stringstream ss;
+        ss << "updated image differs from a full compile at byte " << i;
+        throw std::runtime_error(ss.str());
+    }
+    expect(mismatch(previous, full.ssram) < previous.size(),
+           "the designs compile to the same image");
+}
+
+int main() {
+    CheckSuite suite;
+    suite.add("delta/heat", check_heat);
+    return suite.run();
+}
@@ -0,0 +1,114 @@
+/* Design caches (--emit-design-cache): every design in tests/ compiles to
+   the same bytes from its cache as from its text, and damaged caches are
+   rejected rather than loaded. Run from the repository root. */
+
+#include "harness.hpp"
+#include "design-cache.hpp"
+#include "obc.hpp"
+#include <algorithm>
+#include <filesystem>
+
+static std::vector<uint8_t> emit_cache(std::string_view source,
+                                       std::string const &name) {
+    DesignCacheWriter writer;
+    Parser parser;
+    parser.set_cache(&writer);
+
+    Lexer lexer;
+    lexer.open_view(source, name);
+    parser.parse_chips(lexer);
+    return writer.finish();
+}
+
+static std::string_view view(std::vector<uint8_t> const &blob) {
+    return std::string_view(reinterpret_cast<char const *>(blob.data()),
+                            blob.size());
+}
+
+static void check_round_trip(std::string const &filename) {
+    SourceFile file = SourceFile::Open(filename);
+
+    Lexer lexer;
+    lexer.open_view(file.text(), filename);
+    auto parsed = Parser().parse_chips(lexer);
+
+    std::vector<uint8_t> blob = emit_cache(file.text(), filename);
+    auto loaded = load_design_cache(view(blob), filename);
+    expect(loaded.size() == parsed.size(), "number of chips differs");
+
+    for (std::size_t i = 0; i < parsed.size(); i++) {
+        CompileResult expected = compile_chip(*parsed[i]);
+        CompileResult result = compile_chip(*loaded[i]);
+        expect(result.bytestream == expected.bytestream,
+               "chip " + std::to_string(i) + " differs from the text");
+    }
+}
+
+/* Loading fails with an error that contains what */
+static void expect_rejected(std::vector<uint8_t> const &blob,
+                            std::string const &what) {
+    try {
+        load_design_cache(view(blob), "damaged");
+    } catch (std::runtime_error const &e) {
+        std::string message = e.what();
+        expect(message.find(what) != std::string::npos,
+               "wrong error: " + message);
+        return;
+    }
+    throw std::runtime_error("loaded a cache with " + what);
+}
+
+static void check_damaged() {
+    SourceFile file = SourceFile::Open("tests/heat.acf");
+    std::vector<uint8_t> blob = emit_cache(file.text(), "tests/heat.acf");
+
+    std::vector<uint8_t> flipped = blob;
+    flipped[(design_cache::HeaderSize + flipped.size()) / 2] ^= 0x01;
+    expect_rejected(flipped, "checksum mismatch");
+
+    std::vector<uint8_t> version = blob;
+    version[4] ^= 0xFF;
+    expect_rejected(version, "another version");
+
+    std::vector<uint8_t> truncated(blob.begin(), blob.end() - 3);
+    expect_rejected(truncated, "size mismatch");
+}
+
+/* Steps a valid header cannot vouch for are checked while loading */
+static void check_unknown_values() {
+    AnalogChip chip;
+
+    DesignCacheWriter modes;
+    modes.chip(chip);
+    modes.io_mode(1, static_cast<IOMode>(0x33));
+    expect_rejected(modes.finish(), "unknown IO mode");
+
+    DesignCacheWriter types;
+    types.chip(chip);
+    types.cab_setup(1, 1, 0);
+    types.cam(nullptr, 1, "NoSuchCam", "cam");
+    expect_rejected(types.finish(), "unknown CAM type");
+}
+
+int main() {
+    CheckSuite suite;
+
+    std::vector<std::string> designs;
+    for (auto const &entry : std::filesystem::directory_iterator("tests")) {
+        if (entry.path().extension() == ".acf") {
+            designs.push_back(entry.path().string());
+        }
+    }
+    std::sort(designs.begin(), designs.end());
+
+    for (std::string const &design : designs) {
+        std::string name = std::filesystem::path(design).stem().string();
+        suite.add("design-cache/" + name, [design]() {
+            check_round_trip(design);
+        });
+    }
+    suite.add("design-cache/damaged", check_damaged);
+    suite.add("design-cache/unknown", check_unknown_values);
+
+    return suite.run();
+}
@@ -0,0 +1,70 @@
+/* Editing a Document gives the same diagnostics as setting its whole
+   text at once, whichever tokens and declarations the edit reuses. Run
+   from the repository root. */
+
+#include "harness.hpp"
+#include "document.hpp"
+#include <random>
+#include <sstream>
+
+static std::string describe(std::vector<Diagnostic> const &diagnostics) {
+    std::stringstream ss;
+    for (Diagnostic const &d : diagnostics) {
+        ss << std::endl << "    " << d.severity << " " << d.offset << ": "
+           << d.message;
+    }
+    return ss.str();
+}
+
+static void expect_fresh(Document const &document) {
+    Document fresh(document.source().name());
+    fresh.set_text(document.text());
+
+    std::string edited = describe(document.diagnostics());
+    std::string expected = describe(fresh.diagnostics());
+    expect(edited == expected, "edited:" + edited + "\nfresh:" + expected);
+}
+
+static void check_comment() {
+    Document document("comment.acf");
+    document.set_text("# some comment\nlet a = 1;\n");
+    expect_fresh(document);
+
+    document.edit(4, 4, "x");
+    expect_fresh(document);
+    document.edit(0, 1, "");
+    expect_fresh(document);
+    document.edit(0, 0, "#");
+    expect_fresh(document);
+}
+
+/* Random insertions and deletions, few enough to keep the design mostly
+   valid, with a comment in front of the first declaration */
+static void check_random_edits() {
+    static char const *const Snippets[] = {
+        "", " ", "\n", "#", "x", "1", ";", "}", "let b = 2;", "alpha",
+    };
+
+    SourceFile file = SourceFile::Open("tests/heat.acf");
+    Document document("heat.acf");
+    document.set_text("# heat equation\n" + std::string(file.text()));
+    expect_fresh(document);
+
+    std::mt19937 rng(1);
+    for (int n = 0; n < 200; n++) {
+        std::size_t size = document.text().size();
+        std::size_t begin = rng() % (size + 1);
+        std::size_t end = std::min(size, begin + rng() % 3);
+        char const *text = Snippets[rng() % std::size(Snippets)];
+
+        document.edit(begin, end, text);
+        expect_fresh(document);
+    }
+}
+
+int main() {
+    CheckSuite suite;
+    suite.add("document/comment", check_comment);
+    suite.add("document/random", check_random_edits);
+    return suite.run();
+}
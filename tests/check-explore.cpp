@@ -0,0 +1,91 @@
+/* Exploring placements (--explore) finds a variant that costs no more
+   than the design itself, the same one on any number of threads, and
+   whose output is that of the variant compiled again. tests/sum.acf has
+   a few variants, tests/placed.acf thousands, many of them pruned. Run
+   from the repository root. */
+
+#include "harness.hpp"
+#include "explore.hpp"
+#include <tuple>
+
+static constexpr std::size_t NVariants = 300;
+
+static auto ordered(VariantCost const &cost) {
+    return std::make_tuple(cost.n_channels, cost.n_bytes, cost.n_clocks);
+}
+
+static ExploreResult explore(std::string const &design,
+                             std::size_t n_threads) {
+    SourceFile file = SourceFile::Open(design);
+    CompileOptions options;
+    options.name = design;
+    return run_explore(file.text(), options, NVariants, n_threads);
+}
+
+static void check_cost(std::string const &design) {
+    ExploreResult explored = explore(design, 1);
+
+    expect(explored.design_error.empty(),
+           "the design failed: " + explored.design_error);
+    expect(ordered(explored.cost) <= ordered(explored.design_cost),
+           "the best variant costs more than the design");
+    expect(explored.cost.n_bytes == explored.result.bytestream.size(),
+           "the cost is not that of the result");
+    expect(explored.n_failed + explored.n_pruned < explored.n_variants,
+           "every variant failed or was pruned");
+}
+
+static void check_threads(std::string const &design) {
+    ExploreResult serial = explore(design, 1);
+    ExploreResult parallel = explore(design, 4);
+
+    expect(serial.n_variants == parallel.n_variants,
+           "different numbers of variants");
+    expect(serial.index == parallel.index,
+           "different best variants: " + std::to_string(serial.index)
+           + " and " + std::to_string(parallel.index));
+    expect(serial.result.bytestream == parallel.result.bytestream,
+           "different bytestreams");
+}
+
+static void check_recompile(std::string const &design) {
+    ExploreResult explored = explore(design, 2);
+    std::vector<uint8_t> bytestream = explored.result.bytestream;
+
+    SourceFile file = SourceFile::Open(design);
+    DesignCacheWriter writer;
+    Parser parser;
+    parser.set_cache(&writer);
+    Lexer lexer;
+    lexer.open_view(file.text(), design);
+    parser.parse_chips(lexer);
+
+    std::vector<uint8_t> blob = writer.finish();
+    auto chips = load_design_cache(
+            std::string_view(reinterpret_cast<char const *>(blob.data()),
+                             blob.size()),
+            design, nullptr, &explored.variant);
+    expect(compile_chip(*chips[0]).bytestream == bytestream,
+           "a fresh chip of the variant compiles differently");
+
+    recompile_chip(*explored.chip, explored.result);
+    expect(explored.result.bytestream == bytestream,
+           "recompiling the best variant changes its output");
+}
+
+int main() {
+    CheckSuite suite;
+    for (char const *name : { "sum", "placed" }) {
+        std::string design = std::string("tests/") + name + ".acf";
+        suite.add(std::string("explore/cost/") + name, [design]() {
+            check_cost(design);
+        });
+        suite.add(std::string("explore/threads/") + name, [design]() {
+            check_threads(design);
+        });
+        suite.add(std::string("explore/recompile/") + name, [design]() {
+            check_recompile(design);
+        });
+    }
+    return suite.run();
+}
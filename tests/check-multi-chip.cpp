@@ -0,0 +1,114 @@
+/* Designs with several chips: chips without an address attribute are
+   addressed by their position from 1, only the first 255 can be, and
+   obc writes the chips of tests/multi/three_chips.acf to OUTFILE.<i> or,
+   with --combine, into one stream, as in the golden files next to it.
+   Runs ./obc, so run from the repository root after building it. */
+
+#include "harness.hpp"
+#include "error.hpp"
+#include <cstdlib>
+#include <filesystem>
+
+static std::string const Design = "tests/multi/three_chips.acf";
+
+static std::vector<std::unique_ptr<AnalogChip>> parse_text(
+        std::string const &text) {
+    Lexer lexer;
+    lexer.open_view(text, "chips");
+    return Parser().parse_chips(lexer);
+}
+
+static std::string read_design() {
+    SourceFile file = SourceFile::Open(Design);
+    return std::string(file.text());
+}
+
+static std::string output_file() {
+    return (std::filesystem::temp_directory_path() / "check-multi-chip")
+           .string();
+}
+
+static int run_obc(std::string const &infile, std::string const &options) {
+    std::string command = "./obc " + infile + " " + output_file() + " "
+                        + options + " > /dev/null 2> /dev/null";
+    return std::system(command.c_str());
+}
+
+static void check_addresses() {
+    auto chips = parse_text(read_design());
+    expect(chips.size() == 3, "expected 3 chips");
+
+    int expected[] = { 1, 2, 7 };
+    for (std::size_t i = 0; i < chips.size(); i++) {
+        expect(chips[i]->address() == expected[i],
+               "chip " + std::to_string(i) + " has address "
+               + std::to_string(chips[i]->address()));
+    }
+}
+
+static void check_outputs() {
+    expect(run_obc(Design, "") == 0, "obc failed");
+
+    std::vector<uint8_t> all;
+    for (int i = 0; i < 3; i++) {
+        std::string suffix = "." + std::to_string(i);
+        std::vector<uint8_t> values = read_values(output_file() + suffix);
+        expect(values == read_values("tests/multi/three_chips.out" + suffix),
+               "chip " + std::to_string(i) + " differs from its golden file");
+        all.insert(all.end(), values.begin(), values.end());
+    }
+
+    expect(run_obc(Design, "--combine") == 0, "obc --combine failed");
+    std::vector<uint8_t> combined = read_values(output_file());
+    expect(combined == read_values("tests/multi/three_chips.combined"),
+           "--combine differs from its golden file");
+    expect(combined == all, "--combine is not the chips one after another");
+}
+
+/* An explicit address may not take the default one of another chip */
+static void check_combined_collision() {
+    std::string text = read_design();
+    text.replace(text.find("address: 7"), 10, "address: 1");
+
+    std::string infile = output_file() + ".acf";
+    std::ofstream(infile) << text;
+    expect(run_obc(infile, "--combine") != 0,
+           "combined two chips with address 1");
+}
+
+static void check_default_limit() {
+    std::string text = read_design();
+    std::size_t begin = text.find("chip {");
+    std::size_t end = text.find("chip {", begin + 1);
+    std::string chip = text.substr(begin, end - begin);
+
+    /* The let declarations in front of the first chip */
+    std::string chips = text.substr(0, begin);
+    for (int i = 0; i < 255; i++) {
+        chips += chip;
+    }
+    expect(parse_text(chips).size() == 255, "expected 255 chips");
+
+    std::string addressed = "chip {\n    address: 9," + chip.substr(6);
+    expect(parse_text(chips + addressed)[255]->address() == 9,
+           "chip 256 does not have its explicit address");
+
+    try {
+        parse_text(chips + chip);
+    } catch (SourceError const &e) {
+        std::string message = e.what();
+        expect(message.find("chip 256 needs an address") != std::string::npos,
+               "wrong error: " + message);
+        return;
+    }
+    throw std::runtime_error("chip 256 got a default address");
+}
+
+int main() {
+    CheckSuite suite;
+    suite.add("multi-chip/addresses", check_addresses);
+    suite.add("multi-chip/outputs", check_outputs);
+    suite.add("multi-chip/collision", check_combined_collision);
+    suite.add("multi-chip/default-limit", check_default_limit);
+    return suite.run();
+}
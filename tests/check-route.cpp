@@ -0,0 +1,42 @@
+/* Designs in tests/route/ that cannot be routed fail with the message in
+   the .err file next to them, which lists the links that contend for
+   too few channels. Run from the repository root. */
+
+#include "harness.hpp"
+#include "error.hpp"
+#include "obc.hpp"
+#include <fstream>
+#include <sstream>
+
+static std::string read_text(std::string const &filename) {
+    std::ifstream f(filename);
+    expect(static_cast<bool>(f), "could not open " + filename);
+
+    std::stringstream ss;
+    ss << f.rdbuf();
+    std::string text = ss.str();
+    while (!text.empty() && text.back() == '\n') {
+        text.pop_back();
+    }
+    return text;
+}
+
+static void check_unroutable(std::string const &name) {
+    std::string base = "tests/route/" + name;
+    auto chip = parse_file(base + ".acf");
+
+    try {
+        compile_chip(*chip);
+    } catch (DesignError const &e) {
+        std::string expected = read_text(base + ".err");
+        expect(e.what() == expected, std::string("got:\n") + e.what());
+        return;
+    }
+    throw std::runtime_error("the design was routed");
+}
+
+int main() {
+    CheckSuite suite;
+    suite.add("route/global_bi", []() { check_unroutable("global_bi"); });
+    return suite.run();
+}
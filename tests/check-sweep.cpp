@@ -0,0 +1,123 @@
+/* Sweeping a let constant (--sweep) compiles every point to the same
+   bytes as the design with that value written into its let declaration,
+   and constants that select chip resources cannot be swept. Run from the
+   repository root. */
+
+#include "harness.hpp"
+#include "sweep.hpp"
+#include "obc.hpp"
+#include <iomanip>
+#include <sstream>
+
+/* The source with the value of a let constant replaced */
+static std::string substitute(std::string source, std::string const &name,
+                              double value) {
+    std::string let = "let " + name + " = ";
+    std::size_t begin = source.find(let);
+    expect(begin != std::string::npos, "no let declaration of " + name);
+    begin += let.size();
+    std::size_t end = source.find(';', begin);
+
+    std::stringstream ss;
+    ss << std::setprecision(17) << value;
+    return source.replace(begin, end - begin, ss.str());
+}
+
+static std::vector<uint8_t> compile_text(std::string const &source) {
+    Lexer lexer;
+    lexer.open_view(source, "substituted");
+    auto chip = Parser().parse(lexer);
+    return compile_chip(*chip).bytestream;
+}
+
+static void check_points(std::string const &source, std::string const &spec,
+                         std::size_t n_threads) {
+    SweepRange range = parse_sweep_range(spec);
+    std::vector<std::vector<uint8_t>> bytestreams(range.size());
+
+    CompileOptions options;
+    options.name = spec;
+    SweepResult swept = run_sweep(source, options, range, n_threads,
+            [&](std::size_t i, AnalogChip &, CompileResult const &result) {
+        bytestreams[i] = result.bytestream;
+    });
+
+    for (std::size_t i = 0; i < range.size(); i++) {
+        expect(swept.errors[i].empty(), "point failed: " + swept.errors[i]);
+
+        std::string point = substitute(source, range.constant,
+                                       range.value(i));
+        std::stringstream what;
+        what << range.constant << " = " << range.value(i)
+             << " differs from a fresh compile";
+        expect(bytestreams[i] == compile_text(point), what.str());
+    }
+}
+
+static void expect_unsweepable(std::string const &source,
+                               std::string const &spec) {
+    CompileOptions options;
+    options.name = spec;
+    try {
+        run_sweep(source, options, parse_sweep_range(spec), 1,
+                  [](std::size_t, AnalogChip &, CompileResult const &) {});
+    } catch (std::runtime_error const &e) {
+        std::string message = e.what();
+        expect(message.find("determines the chip structure")
+                       != std::string::npos,
+               "wrong error: " + message);
+        return;
+    }
+    throw std::runtime_error("swept " + spec);
+}
+
+static std::string heat() {
+    SourceFile file = SourceFile::Open("tests/heat.acf");
+    return std::string(file.text());
+}
+
+static std::string const SumDesign = R"(
+let Cab = 2;
+let Port = 1;
+let gain = 1;
+
+chip {
+    io: [ input, output ],
+    cabs: [
+        cab Cab with clocks 1, - {
+            cams: [
+                SumInv as sum { inputs: 2, gain1: gain, gain2: gain }
+            ]
+        }
+    ],
+    routing: [
+        io1 -> sum:Port,
+        sum -> io2
+    ]
+}
+)";
+
+int main() {
+    CheckSuite suite;
+
+    suite.add("sweep/gains", []() {
+        check_points(heat(), "alpha=0.5:2:0.25", 3);
+    });
+    suite.add("sweep/integrators", []() {
+        check_points(heat(), "beta=1:4:0.5", 1);
+    });
+    suite.add("sweep/dependent", []() {
+        std::string source = heat();
+        source.replace(source.find("let beta = 4;"), 13,
+                       "let beta = alpha * 4;");
+        check_points(source, "alpha=0.5:1:0.125", 2);
+    });
+    suite.add("sweep/structural", []() {
+        expect_unsweepable(heat(), "ClkA=1:2:1");
+        expect_unsweepable(SumDesign, "Cab=1:2:1");
+        expect_unsweepable(SumDesign, "Port=1:2:1");
+        check_points(SumDesign, "gain=0.5:2:0.5", 2);
+    });
+
+    return suite.run();
+}
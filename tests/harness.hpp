@@ -0,0 +1,80 @@
+#ifndef OBC_TESTS_HARNESS_HPP
+#define OBC_TESTS_HARNESS_HPP
+
+/* Minimal harness for the checks of libobc in tests/: every check runs
+   its cases, reports them like scripts/test.py and exits with status 1
+   if any failed. A case fails by throwing. */
+
+#include "lexer.hpp"
+#include "parser.hpp"
+#include "source-file.hpp"
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include <cstdint>
+
+class CheckSuite {
+public:
+    void add(std::string name, std::function<void()> run) {
+        m_cases.push_back({ std::move(name), std::move(run) });
+    }
+
+    int run() {
+        std::size_t n_passed = 0;
+        for (Case const &c : m_cases) {
+            try {
+                c.run();
+                n_passed++;
+                std::cout << "\033[92m" << c.name << " passed\033[0m"
+                          << std::endl;
+            } catch (std::exception const &e) {
+                std::cout << "\033[91m" << c.name << " failed: " << e.what()
+                          << "\033[0m" << std::endl;
+            }
+        }
+
+        std::cout << n_passed << " / " << m_cases.size() << " passed."
+                  << std::endl;
+        return n_passed == m_cases.size() ? 0 : 1;
+    }
+
+private:
+    struct Case {
+        std::string name;
+        std::function<void()> run;
+    };
+
+    std::vector<Case> m_cases;
+};
+
+inline void expect(bool condition, std::string const &what) {
+    if (!condition) {
+        throw std::runtime_error(what);
+    }
+}
+
+/* Byte values of a file written by obc, as in the .out files */
+inline std::vector<uint8_t> read_values(std::string const &filename) {
+    std::ifstream f(filename);
+    expect(static_cast<bool>(f), "could not open " + filename);
+
+    std::vector<uint8_t> values;
+    for (int value; f >> value; ) {
+        values.push_back(static_cast<uint8_t>(value));
+    }
+    return values;
+}
+
+/* Elaborates the first chip of a design file */
+inline std::unique_ptr<AnalogChip> parse_file(std::string const &filename) {
+    SourceFile file = SourceFile::Open(filename);
+    Lexer lexer;
+    lexer.open_view(file.text(), filename);
+    return Parser().parse(lexer);
+}
+
+#endif